@@ -0,0 +1,493 @@
+#include <cctype>
+#include <charconv>
+#include <algorithm>
+#include "proof_checker.hpp"
+#include "../math/helper.hpp"
+#include "../math/rules.hpp"
+
+
+namespace
+{
+
+// value of text which is whole decimal number, 0 otherwise
+std::size_t number(std::string_view text)
+{
+	std::size_t value = 0;
+	const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+	return error == std::errc() && end == text.data() + text.size() ? value : 0;
+}
+
+}
+
+
+ProofChecker::ProofChecker(report_function report, std::vector<Expression> axioms, std::vector<Rule> rules)
+	: report_(std::move(report))
+	, axioms_(std::move(axioms))
+	, rules_(std::move(rules))
+	, store_()
+	, schemas_()
+	, rule_set_()
+	, targets_()
+	, hypotheses_()
+	, lines_()
+	, levels_()
+	, changed_(INVALID_TERM)
+	, changed_level_(0)
+	, bindings_()
+	, result_()
+	, active_(false)
+	, line_(0)
+{
+	if (axioms_.empty())
+	{
+		axioms_ = {
+			Expression("a>(b>a)"),
+			Expression("(a>(b>c))>((a>b)>(a>c))"),
+			Expression("(!a>!b)>((!a>b)>a)")
+		};
+	}
+}
+
+
+void ProofChecker::begin(std::string_view input)
+{
+	active_ = true;
+	result_ = CheckResult();
+	result_.input = input;
+
+	// formulas of previous proof are released
+	store_ = std::make_unique<TermStore>();
+	schemas_.clear();
+	for (const auto &axiom : axioms_)
+	{
+		schemas_.push_back(store_->intern(axiom));
+	}
+	rule_set_ = RuleSet(*store_, rules_);
+
+	targets_.clear();
+	hypotheses_.clear();
+	lines_.clear();
+	levels_.clear();
+	changed_ = INVALID_TERM;
+	bindings_.clear();
+
+	targets_.push_back(formula(input, true));
+	if (targets_.back() == INVALID_TERM)
+	{
+		fail("malformed input");
+	}
+}
+
+
+bool ProofChecker::fail(const std::string &message)
+{
+	if (result_.error.empty())
+	{
+		result_.error = "line " + std::to_string(line_) + ": " + message;
+	}
+
+	return false;
+}
+
+
+bool ProofChecker::proves_target(term_id fact, std::size_t level) const
+{
+	for (std::size_t k = level; k < targets_.size(); ++k)
+	{
+		if (targets_[k] == fact)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+term_id ProofChecker::formula(std::string_view text, bool standardize)
+{
+	// letters are leaves in preorder, so their case marks constants
+	std::string lowered;
+	std::vector<bool> constants;
+	std::int32_t depth = 0;
+
+	for (const auto c : text)
+	{
+		if (std::islower(static_cast<unsigned char>(c)) || std::isupper(static_cast<unsigned char>(c)))
+		{
+			constants.push_back(std::islower(static_cast<unsigned char>(c)));
+			lowered += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+			continue;
+		}
+
+		if (c == '(' || c == ')')
+		{
+			depth += c == '(' ? 1 : -1;
+			if (depth < 0)
+			{
+				return INVALID_TERM;
+			}
+		}
+		else if (std::string_view("!>|*+=").find(c) == std::string_view::npos)
+		{
+			return INVALID_TERM;
+		}
+
+		lowered += c;
+	}
+
+	if (depth != 0 || constants.empty())
+	{
+		return INVALID_TERM;
+	}
+
+	Expression expression;
+	try
+	{
+		expression = Expression(lowered);
+	}
+	catch (const std::exception &)
+	{
+		return INVALID_TERM;
+	}
+
+	std::vector<Term> preorder;
+	std::size_t leaf = 0;
+
+	for (std::size_t i = 0; i < expression.size(); ++i)
+	{
+		auto term = expression[i];
+		if (term.type != term_t::Function)
+		{
+			if (leaf == constants.size())
+			{
+				return INVALID_TERM;
+			}
+
+			if (constants[leaf++])
+			{
+				term.type = term_t::Constant;
+			}
+		}
+
+		preorder.push_back(term);
+	}
+
+	// parser skips some malformed parts instead of rejecting them
+	if (leaf != constants.size())
+	{
+		return INVALID_TERM;
+	}
+
+	Expression result(preorder);
+	if (standardize)
+	{
+		result.standardize();
+	}
+
+	return store_->intern(result);
+}
+
+
+bool ProofChecker::check_normalized(std::string_view text)
+{
+	if (formula(text) != targets_.front())
+	{
+		return fail("normalized input isn't standardized input");
+	}
+
+	return true;
+}
+
+
+bool ProofChecker::check_deduction(std::string_view text)
+{
+	// Γ ⊢ a>b <=> Γ U {a} ⊢ b
+	constexpr const std::string_view context = "Γ ⊢ ";
+	constexpr const std::string_view extended = " <=> Γ U {";
+	constexpr const std::string_view derives = "} ⊢ ";
+
+	const auto middle = text.find(extended);
+	const auto end = text.find(derives, middle);
+
+	if (!text.starts_with(context) || middle == std::string_view::npos || end == std::string_view::npos)
+	{
+		return fail("malformed deduction theorem");
+	}
+
+	if (!lines_.empty())
+	{
+		return fail("deduction theorem after proof lines");
+	}
+
+	const auto whole = formula(text.substr(context.size(), middle - context.size()));
+	const auto hypothesis = formula(text.substr(middle + extended.size(), end - middle - extended.size()));
+	const auto rest = formula(text.substr(end + derives.size()));
+
+	if (whole == INVALID_TERM || hypothesis == INVALID_TERM || rest == INVALID_TERM)
+	{
+		return fail("malformed formula");
+	}
+
+	if (whole != targets_.back())
+	{
+		return fail("deduction theorem isn't applied to current target");
+	}
+
+	if (store_->term(whole).op != operation_t::Implication ||
+		store_->left(whole) != hypothesis ||
+		store_->right(whole) != rest)
+	{
+		return fail("deduction theorem splits implication into other formulas");
+	}
+
+	hypotheses_.try_emplace(hypothesis, targets_.size());
+	targets_.push_back(rest);
+	return true;
+}
+
+
+bool ProofChecker::check_step(std::string_view text)
+{
+	// N. axiom: f, N. mp(i,j): f or N. rule(i,j,...): f
+	const auto dot = text.find(". ");
+	const auto colon = text.find(": ");
+
+	if (dot == std::string_view::npos || colon == std::string_view::npos || colon < dot)
+	{
+		return fail("malformed proof line");
+	}
+
+	const auto index = number(text.substr(0, dot));
+	if (index != lines_.size() + 1)
+	{
+		return fail("expected proof line " + std::to_string(lines_.size() + 1));
+	}
+
+	const auto rule = text.substr(dot + 2, colon - dot - 2);
+	const auto fact = formula(text.substr(colon + 2));
+
+	if (fact == INVALID_TERM)
+	{
+		return fail("malformed formula");
+	}
+
+	std::size_t level = 0;
+
+	if (rule == "axiom")
+	{
+		const auto hypothesis = hypotheses_.find(fact);
+		if (hypothesis != hypotheses_.end())
+		{
+			level = hypothesis->second;
+		}
+		else if (std::ranges::none_of(schemas_, [&] (term_id schema) {
+			return matches(*store_, schema, fact);
+		}))
+		{
+			return fail("neither axiom instance nor hypothesis");
+		}
+	}
+	else if (rule.starts_with("mp(") && rule.ends_with(")") && rule.find(',') != std::string_view::npos)
+	{
+		const auto comma = rule.find(',');
+		const auto premise = number(rule.substr(3, comma - 3));
+		const auto implication = number(rule.substr(comma + 1, rule.size() - comma - 2));
+
+		// only previous lines may be cited, so proof is acyclic
+		if (premise == 0 || implication == 0 || premise >= index || implication >= index)
+		{
+			return fail("mp cites line which isn't proved before");
+		}
+
+		const auto consequence = modus_ponens(*store_, lines_[premise - 1], lines_[implication - 1]);
+		if (consequence.empty() || !matches(*store_, store_->intern(consequence), fact))
+		{
+			return fail("not an instance of " + std::string(rule));
+		}
+
+		level = std::max(levels_[premise - 1], levels_[implication - 1]);
+	}
+	else if (rule.ends_with(")") && rule.find('(') != std::string_view::npos)
+	{
+		// name(i,j,...) of derived rule, premises are cited in order of its schema
+		const auto open = rule.find('(');
+		const auto *derived = rule_set_.find(rule.substr(0, open));
+		if (derived == nullptr)
+		{
+			return fail("unknown rule " + std::string(rule));
+		}
+
+		std::vector<term_id> premises;
+		for (auto list = rule.substr(open + 1, rule.size() - open - 2); !list.empty();)
+		{
+			const auto comma = std::min(list.find(','), list.size());
+			const auto premise = number(list.substr(0, comma));
+
+			if (premise == 0 || premise >= index)
+			{
+				return fail(derived->name + " cites line which isn't proved before");
+			}
+
+			premises.push_back(lines_[premise - 1]);
+			level = std::max(level, levels_[premise - 1]);
+			list.remove_prefix(std::min(comma + 1, list.size()));
+		}
+
+		if (premises.size() != derived->premises.size())
+		{
+			return fail(derived->name + " takes " + std::to_string(derived->premises.size()) + " premises");
+		}
+
+		std::pmr::vector<Term> consequence;
+		if (!apply(*store_, *derived, premises, consequence) ||
+			!matches(*store_, store_->intern(Expression(consequence)), fact))
+		{
+			return fail("not an instance of " + std::string(rule));
+		}
+	}
+	else
+	{
+		return fail("unknown rule " + std::string(rule));
+	}
+
+	lines_.push_back(fact);
+	levels_.push_back(level);
+	++result_.steps;
+
+	if (proves_target(fact, level))
+	{
+		result_.proved = true;
+	}
+
+	return true;
+}
+
+
+bool ProofChecker::check_change(std::string_view text)
+{
+	const auto fact = formula(text);
+	const auto line = std::ranges::find(lines_, fact);
+
+	if (fact == INVALID_TERM || line == lines_.end())
+	{
+		return fail("variables are changed in formula which isn't proved");
+	}
+
+	changed_ = fact;
+	changed_level_ = levels_[line - lines_.begin()];
+	bindings_.clear();
+	return true;
+}
+
+
+bool ProofChecker::check_binding(std::string_view text)
+{
+	// A -> f
+	const auto value = static_cast<std::size_t>(text[0] - 'A' + 1);
+	const auto binding = formula(text.substr(5));
+
+	if (changed_ == INVALID_TERM || binding == INVALID_TERM)
+	{
+		return fail("malformed substitution");
+	}
+
+	if (bindings_.size() <= value)
+	{
+		bindings_.resize(value + 1, INVALID_TERM);
+	}
+
+	if (bindings_[value] != INVALID_TERM)
+	{
+		return fail("variable is substituted twice");
+	}
+
+	bindings_[value] = binding;
+	return true;
+}
+
+
+bool ProofChecker::check_proved(std::string_view text)
+{
+	const auto fact = formula(text);
+
+	if (changed_ == INVALID_TERM || fact == INVALID_TERM ||
+		substitute(*store_, changed_, bindings_, 0) != fact)
+	{
+		return fail("proved formula isn't result of substitution");
+	}
+
+	if (!proves_target(fact, changed_level_))
+	{
+		return fail("proved formula isn't target or depends on its later hypotheses");
+	}
+
+	result_.proved = true;
+	return true;
+}
+
+
+void ProofChecker::feed(std::string_view line)
+{
+	++line_;
+
+	if (line.ends_with('\r'))
+	{
+		line.remove_suffix(1);
+	}
+
+	if (line.starts_with("input: "))
+	{
+		finish();
+		begin(line.substr(7));
+		return;
+	}
+
+	// nothing is checked after the first error
+	if (!active_ || !result_.error.empty())
+	{
+		return;
+	}
+
+	if (line.starts_with("normalized input: "))
+	{
+		check_normalized(line.substr(18));
+	}
+	else if (line.starts_with("deduction theorem: "))
+	{
+		check_deduction(line.substr(19));
+	}
+	else if (!line.empty() && std::isdigit(static_cast<unsigned char>(line[0])))
+	{
+		check_step(line);
+	}
+	else if (line.starts_with("change variables: "))
+	{
+		check_change(line.substr(18));
+	}
+	else if (line.starts_with("proved: "))
+	{
+		check_proved(line.substr(8));
+	}
+	else if (line.size() > 5 && std::isupper(static_cast<unsigned char>(line[0])) && line.substr(1, 4) == " -> ")
+	{
+		check_binding(line);
+	}
+}
+
+
+void ProofChecker::finish()
+{
+	if (!active_)
+	{
+		return;
+	}
+
+	if (!result_.proved && result_.steps != 0)
+	{
+		fail("proof doesn't reach target");
+	}
+
+	active_ = false;
+	report_(result_);
+}
@@ -0,0 +1,107 @@
+#ifndef PROOF_CHECKER_HPP
+#define PROOF_CHECKER_HPP
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+#include "../math/ast.hpp"
+#include "../math/term_store.hpp"
+#include "../math/rule_schema.hpp"
+
+
+/**
+ * @brief verdict on one proof of stream, proof starts with `input:` line
+ */
+struct CheckResult
+{
+	std::string input;
+
+	// verified numbered lines
+	std::size_t steps = 0;
+
+	// target is reached by verified lines
+	bool proved = false;
+
+	// first error as "line N: message", empty if proof is valid
+	std::string error;
+};
+
+
+/**
+ * @brief streaming checker of thought chains printed by solver
+ *
+ * @note every line is checked once against cited lines: axioms must be
+ * instances of axiom schemas or hypotheses of deduction theorem, mp lines
+ * must be instances of modus ponens of cited lines, lines of derived rules
+ * must be instances of their conclusions over cited premises. Any target of deduction
+ * theorem may be proved by lines which use only its hypotheses.
+ * Only formulas of current proof are kept, hash-consed, text of lines
+ * is not stored. Uppercase letters are variables, lowercase ones are constants.
+ */
+class ProofChecker
+{
+	using report_function = std::function<void(const CheckResult &)>;
+
+	report_function report_;
+	std::vector<Expression> axioms_;
+	std::vector<Rule> rules_;
+
+	// state of current proof, reset by every `input:` line
+	std::unique_ptr<TermStore> store_;
+	std::vector<term_id> schemas_;
+	RuleSet rule_set_;
+
+	// targets of deduction theorem, hypothesis of k-th target is k-th one
+	std::vector<term_id> targets_;
+	std::unordered_map<term_id, std::size_t> hypotheses_;
+
+	// facts of proof lines and number of hypotheses they depend on
+	std::vector<term_id> lines_;
+	std::vector<std::size_t> levels_;
+
+	// fact of `change variables:` and bindings of its variables
+	term_id changed_;
+	std::size_t changed_level_;
+	std::vector<term_id> bindings_;
+
+	CheckResult result_;
+	bool active_;
+	std::size_t line_;
+
+	void begin(std::string_view input);
+	bool fail(const std::string &message);
+
+	// fact of proof line proves target which has all its hypotheses
+	bool proves_target(term_id fact, std::size_t level) const;
+
+	// INVALID_TERM if text isn't well-formed formula
+	term_id formula(std::string_view text, bool standardize = false);
+
+	bool check_normalized(std::string_view text);
+	bool check_deduction(std::string_view text);
+	bool check_step(std::string_view text);
+	bool check_change(std::string_view text);
+	bool check_binding(std::string_view text);
+	bool check_proved(std::string_view text);
+public:
+	/**
+	 * @brief `report` is called for every finished proof
+	 * @note proofs use axioms of solver unless others are given,
+	 * derived rules are standard ones of rule_schema.hpp unless others are given
+	 */
+	explicit ProofChecker(
+		report_function report,
+		std::vector<Expression> axioms = {},
+		std::vector<Rule> rules = standard_rules()
+	);
+
+	void feed(std::string_view line);
+
+	// report the last proof of stream
+	void finish();
+};
+
+#endif // PROOF_CHECKER_HPP
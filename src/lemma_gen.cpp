@@ -0,0 +1,195 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cctype>
+#include <algorithm>
+#include <unordered_set>
+#include "./math/ast.hpp"
+#include "./math/helper.hpp"
+#include "./math/rules.hpp"
+#include "./math/term_store.hpp"
+#include "./solver/derivation.hpp"
+#include "./solver/lemma_table.hpp"
+
+
+namespace
+{
+
+/**
+ * @brief lemma of saturation, axioms have no premises
+ */
+struct Lemma
+{
+	term_id fact;
+	std::uint32_t premise;
+	std::uint32_t implication;
+	std::size_t depth;
+};
+
+
+// the same filter as solver applies to facts of search
+bool is_good(const TermStore &store, term_id fact, std::size_t max_size)
+{
+	std::size_t conjunctions = 0;
+	std::vector<term_id> s = {fact};
+
+	while (!s.empty())
+	{
+		const auto current = s.back();
+		s.pop_back();
+
+		const auto &term = store.term(current);
+		if (term.type == term_t::Function)
+		{
+			conjunctions += term.op == operation_t::Conjunction;
+			s.push_back(store.left(current));
+			s.push_back(store.right(current));
+		}
+	}
+
+	return store.size(fact) <= max_size &&
+		store.term(fact).op != operation_t::Conjunction &&
+		conjunctions <= 1;
+}
+
+
+// schema text which parser reads back, every letter is variable
+std::string schema_text(const TermStore &store, term_id fact)
+{
+	auto text = store.to_string(fact);
+	for (auto &c : text)
+	{
+		c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+	}
+
+	return text;
+}
+
+}
+
+
+/**
+ * lemmas of the standard axioms up to DEPTH mp steps are derived through steps
+ * of up to STEPS nodes, lemmas subsumed by previous ones are skipped. Lemmas of
+ * up to SIZE nodes are printed as entries of table of lemma_table.hpp together
+ * with steps of their derivations, SEED lemmas are marked as the first facts of search
+ */
+int main(int argc, char *argv[])
+{
+	if (argc < 4)
+	{
+		std::cerr << "usage: " << argv[0] << " DEPTH SIZE STEPS [SEED...]\n";
+		return 1;
+	}
+
+	const auto max_depth = std::stoul(argv[1]);
+	const auto max_size = std::stoul(argv[2]);
+	const auto max_step = std::max(max_size, std::stoul(argv[3]));
+
+	TermStore store;
+	std::vector<Lemma> lemmas;
+	std::unordered_set<term_id> known;
+
+	std::unordered_set<term_id> seeds;
+	for (int i = 4; i < argc; ++i)
+	{
+		seeds.insert(store.normalize(store.intern(Expression(argv[i]))));
+	}
+
+	for (const auto &axiom : hilbert_axioms())
+	{
+		const auto fact = store.normalize(store.intern(axiom));
+		lemmas.push_back({fact, NO_PREMISE, NO_PREMISE, 0});
+		known.insert(fact);
+	}
+
+	// every pair with a lemma of the previous depth is combined once
+	for (std::size_t depth = 1; depth <= max_depth; ++depth)
+	{
+		const auto count = static_cast<std::uint32_t>(lemmas.size());
+
+		for (std::uint32_t i = 0; i < count; ++i)
+		{
+			for (std::uint32_t j = 0; j < count; ++j)
+			{
+				if (std::max(lemmas[i].depth, lemmas[j].depth) + 1 != depth)
+				{
+					continue;
+				}
+
+				const auto consequence = modus_ponens(store, lemmas[i].fact, lemmas[j].fact);
+				if (consequence.empty())
+				{
+					continue;
+				}
+
+				const auto fact = store.normalize(store.intern(consequence));
+				if (!is_good(store, fact, max_step) || !known.insert(fact).second)
+				{
+					continue;
+				}
+
+				const bool subsumed = std::ranges::any_of(lemmas, [&] (const Lemma &lemma) {
+					return matches(store, lemma.fact, fact);
+				});
+
+				if (!subsumed)
+				{
+					lemmas.push_back({fact, i, j, depth});
+				}
+			}
+		}
+	}
+
+	// small lemmas and steps they depend on, in order of derivation
+	std::vector<bool> required(lemmas.size());
+	for (auto i = lemmas.size(); i-- > 0;)
+	{
+		if (store.size(lemmas[i].fact) <= max_size || lemmas[i].premise == NO_PREMISE)
+		{
+			required[i] = true;
+		}
+
+		if (required[i] && lemmas[i].premise != NO_PREMISE)
+		{
+			required[lemmas[i].premise] = true;
+			required[lemmas[i].implication] = true;
+		}
+	}
+
+	std::vector<std::uint32_t> indices(lemmas.size());
+	std::uint32_t index = 0;
+
+	std::cout << "// generated by lemma-gen " << max_depth << ' ' << max_size << ' ' << max_step << ", don't edit\n";
+	for (std::size_t i = 0; i < lemmas.size(); ++i)
+	{
+		if (!required[i])
+		{
+			continue;
+		}
+
+		const auto &lemma = lemmas[i];
+		indices[i] = index++;
+		std::cout << "{\"" << schema_text(store, lemma.fact) << "\", ";
+
+		if (lemma.premise == NO_PREMISE)
+		{
+			std::cout << "NO_PREMISE, NO_PREMISE, false, false},\n";
+		}
+		else
+		{
+			const bool seed = seeds.erase(lemma.fact) != 0;
+			std::cout << indices[lemma.premise] << ", " << indices[lemma.implication] << ", "
+				<< (store.size(lemma.fact) <= max_size ? "true" : "false") << ", "
+				<< (seed ? "true" : "false") << "},\n";
+		}
+	}
+
+	if (!seeds.empty())
+	{
+		std::cerr << "[-] error: seed " << schema_text(store, *seeds.begin()) << " isn't derived\n";
+		return 1;
+	}
+
+	return 0;
+}
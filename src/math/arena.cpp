@@ -0,0 +1,69 @@
+#include <algorithm>
+#include "arena.hpp"
+
+
+Arena::Arena(std::size_t block_size)
+	: blocks_()
+	, block_size_(std::max<std::size_t>(block_size, 64))
+	, current_(0)
+	, offset_(0)
+{
+	blocks_.push_back({std::make_unique<std::byte[]>(block_size_), block_size_});
+}
+
+
+void *Arena::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+	while (true)
+	{
+		auto &block = blocks_[current_];
+		const auto base = reinterpret_cast<std::uintptr_t>(block.data.get());
+		const auto aligned = (base + offset_ + alignment - 1) & ~(alignment - 1);
+		const auto end = aligned - base + bytes;
+
+		if (end <= block.size)
+		{
+			offset_ = end;
+			return reinterpret_cast<void *>(aligned);
+		}
+
+		// move to the next block, allocate new one if required
+		++current_;
+		offset_ = 0;
+
+		if (current_ == blocks_.size())
+		{
+			const auto size = std::max(block_size_, bytes + alignment);
+			blocks_.push_back({std::make_unique<std::byte[]>(size), size});
+		}
+	}
+}
+
+
+void Arena::do_deallocate(void *, std::size_t, std::size_t)
+{}
+
+
+bool Arena::do_is_equal(const std::pmr::memory_resource &other) const noexcept
+{
+	return this == &other;
+}
+
+
+void Arena::reset() noexcept
+{
+	current_ = 0;
+	offset_ = 0;
+}
+
+
+std::size_t Arena::capacity() const noexcept
+{
+	std::size_t capacity = 0;
+	for (const auto &block : blocks_)
+	{
+		capacity += block.size;
+	}
+
+	return capacity;
+}
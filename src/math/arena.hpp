@@ -0,0 +1,49 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <memory_resource>
+
+
+/**
+ * @brief bump allocator which is reset wholesale
+ *
+ * @note deallocation is no-op, memory is reused after `reset` and
+ * returned to the heap only on destruction, so steady state has no heap traffic
+ */
+class Arena : public std::pmr::memory_resource
+{
+	struct Block
+	{
+		std::unique_ptr<std::byte[]> data;
+		std::size_t size;
+	};
+
+	std::vector<Block> blocks_;
+	std::size_t block_size_;
+
+	// current block and position in it
+	std::size_t current_;
+	std::size_t offset_;
+
+protected:
+	void *do_allocate(std::size_t bytes, std::size_t alignment) override;
+	void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override;
+	bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+
+public:
+	explicit Arena(std::size_t block_size = 1 << 16);
+	Arena(const Arena &) = delete;
+	Arena &operator=(const Arena &) = delete;
+
+	// everything allocated before is released at once
+	void reset() noexcept;
+
+	// bytes owned by arena
+	std::size_t capacity() const noexcept;
+};
+
+#endif // ARENA_HPP
@@ -1,11 +1,9 @@
 #include <algorithm>
 #include <vector>
-#include <sstream>
 #include <unordered_map>
 #include <iostream>
 #include <stack>
 #include <queue>
-#include <functional>
 #include <string>
 #include <numeric>
 #include "ast.hpp"
@@ -46,15 +44,44 @@ operation_t opposite(operation_t operation_t)
 }
 
 
-std::size_t increase_index(std::size_t index, std::size_t offset)
+NegatedOperation negate_operation(operation_t operation)
 {
-	return index == INVALID_INDEX ? INVALID_INDEX : index + offset;
+	const auto inverse = opposite(operation);
+	return {
+		inverse,
+		operation == operation_t::Disjunction,
+		inverse == operation_t::Implication || inverse == operation_t::Conjunction
+	};
 }
 
 
-std::size_t decrease_index(std::size_t index, std::size_t offset)
-{
-	return index == INVALID_INDEX || offset > index ? INVALID_INDEX : index - offset;
+std::uint64_t node_hash(
+	term_t type,
+	operation_t op,
+	value_t value,
+	std::uint64_t left,
+	std::uint64_t right
+) noexcept
+{
+	// splitmix64 finalizer over packed term and subtree hashes
+	auto mix = [] (std::uint64_t x) -> std::uint64_t
+	{
+		x ^= x >> 30;
+		x *= 0xBF58476D1CE4E5B9ULL;
+		x ^= x >> 27;
+		x *= 0x94D049BB133111EBULL;
+		x ^= x >> 31;
+		return x;
+	};
+
+	std::uint64_t h = static_cast<std::uint64_t>(type) << 40 |
+		static_cast<std::uint64_t>(op) << 32 |
+		static_cast<std::uint32_t>(value);
+
+	h = mix(h + 0x9E3779B97F4A7C15ULL);
+	h = mix(h ^ (left + 0x9E3779B97F4A7C15ULL));
+	h = mix(h ^ (right * 0xC2B2AE3D27D4EB4FULL + 0x165667B19E3779F9ULL));
+	return h;
 }
 
 
@@ -65,40 +92,38 @@ Term::Term(term_t type, operation_t op, value_t value) noexcept
 {}
 
 
-std::string Term::to_string() const noexcept
+/**
+ * @brief append text of term to `out`
+ */
+void append_term(std::string &out, const Term &term)
 {
-	std::stringstream representation;
-
-	if (type == term_t::None)
+	if (term.type == term_t::None)
 	{
-		representation << "None";
-		return representation.str();
+		out += "None";
+		return;
 	}
 
-	if (type == term_t::Function)
+	if (term.type == term_t::Function)
 	{
-		representation << operation_dict.at(op);
+		out += operation_dict.at(term.op);
+		return;
 	}
-	else
-	{
-		if (op == operation_t::Negation)
-		{
-			representation << '!';
-		}
 
-		if (type == term_t::Constant)
-		{
-			char suitable_constant = std::abs(value) - 1 + 'a';
-			representation << suitable_constant;
-		}
-		else
-		{
-			char suitable_constant = std::abs(value) - 1 + 'A';
-			representation << suitable_constant;
-		}
+	if (term.op == operation_t::Negation)
+	{
+		out += '!';
 	}
 
-	return representation.str();
+	const char first = term.type == term_t::Constant ? 'a' : 'A';
+	out += static_cast<char>(std::abs(term.value) - 1 + first);
+}
+
+
+std::string Term::to_string() const noexcept
+{
+	std::string representation;
+	append_term(representation, *this);
+	return representation;
 }
 
 
@@ -114,46 +139,55 @@ Expression::Expression() = default;
 Expression::Expression(std::string_view expression)
 {
 	nodes_ = std::move(ExpressionParser(expression).parse().nodes_);
-	modified_ = true;
 }
 
 
 Expression::Expression(Term term)
 {
-	nodes_.emplace_back(
-		term,
-		Relation(0)
-	);
-
-	modified_ = true;
+	nodes_.push_back({
+		pack_tag(term.type, term.op),
+		term.type == term_t::Function ? 0 : term.value
+	});
 }
 
 
 Expression::Expression(const Expression &other)
 	: nodes_(other.nodes_)
-	, representation_(other.representation_)
-	, modified_(true)
 {}
 
 
 Expression::Expression(Expression &&other)
 	: nodes_(std::move(other.nodes_))
-	, representation_(std::move(other.representation_))
-	, modified_(true)
 {}
 
 
-Expression::Expression(const std::vector<Node> &nodes)
-	: nodes_(nodes)
+Expression::Expression(std::span<const Term> preorder)
 {
-	modified_ = true;
-}
+	nodes_.reserve(preorder.size());
 
+	// functions which are still waiting for right child
+	SmallVector<std::size_t, EXPRESSION_INLINE_NODES> parents;
 
-Expression::Expression(std::vector<Node> &&nodes)
-	: nodes_(std::move(nodes))
-{
-	modified_ = true;
+	for (const auto &term : preorder)
+	{
+		const auto self = nodes_.size();
+
+		// node after leaf is right child, node after function is its left one
+		if (self != 0 && !is_function(self - 1))
+		{
+			const auto parent = parents.back();
+			parents.pop_back();
+			nodes_[parent].payload = static_cast<std::int32_t>(self - parent);
+		}
+
+		const bool function = term.type == term_t::Function;
+		nodes_.push_back({pack_tag(term.type, term.op), function ? 0 : term.value});
+
+		if (function)
+		{
+			parents.push_back(self);
+		}
+	}
 }
 
 
@@ -165,7 +199,6 @@ Expression &Expression::operator=(const Expression &other)
 	}
 
 	nodes_ = other.nodes_;
-	modified_ = true;
 	return *this;
 }
 
@@ -178,11 +211,22 @@ Expression &Expression::operator=(Expression &&other)
 	}
 
 	nodes_ = std::move(other.nodes_);
-	modified_ = true;
 	return *this;
 }
 
 
+std::size_t Expression::end(std::size_t idx) const noexcept
+{
+	// last node of subtree is the last one of its right spine
+	while (is_function(idx))
+	{
+		idx += nodes_[idx].payload;
+	}
+
+	return idx + 1;
+}
+
+
 std::size_t Expression::size() const noexcept
 {
 	return nodes_.size();
@@ -191,22 +235,10 @@ std::size_t Expression::size() const noexcept
 
 std::size_t Expression::operations(operation_t op) const noexcept
 {
-	std::size_t count = 0;
-
-	for (const auto &node : nodes_)
-	{
-		if (node.term.type != term_t::Function)
-		{
-			continue;
-		}
-
-		if (node.term.op == op)
-		{
-			++count;
-		}
-	}
-
-	return count;
+	const auto tag = pack_tag(term_t::Function, op);
+	return std::ranges::count_if(nodes_, [&] (const auto &node) {
+		return node.tag == tag;
+	});
 }
 
 
@@ -223,9 +255,9 @@ std::vector<value_t> Expression::variables() const noexcept
 
 	for (const auto &node : nodes_)
 	{
-		if (node.term.type == term_t::Variable)
+		if (tag_type(node.tag) == term_t::Variable)
 		{
-			vars.push_back(node.term.value);
+			vars.push_back(node.payload);
 		}
 	}
 
@@ -233,57 +265,59 @@ std::vector<value_t> Expression::variables() const noexcept
 }
 
 
-void Expression::recalculate_representation() noexcept
+std::string Expression::to_string() const noexcept
 {
 	if (empty())
 	{
-		representation_ = "empty";
-		modified_ = false;
-		return;
+		return "empty";
 	}
 
-	std::stringstream ss;
-	std::function<void(std::ostream &, Relation, const Expression &)> f =
-	[&] (std::ostream &out, Relation root, const Expression &expression)
+	// closing bracket is postponed as a separate action
+	constexpr const std::size_t CLOSE_BRACKET = INVALID_INDEX - 1;
+
+	// node is printed when it's popped the second time, after its left subtree
+	std::vector<std::pair<std::size_t, bool>> s;
+	s.emplace_back(0, false);
+
+	std::string out;
+	out.reserve(2 * nodes_.size());
+
+	while (!s.empty())
 	{
-		if (root.self() == INVALID_INDEX)
+		const auto [idx, visited] = s.back();
+		s.pop_back();
+
+		if (idx == CLOSE_BRACKET)
 		{
-			return;
+			out += ')';
+			continue;
 		}
 
-		const bool brackets = root.parent() != INVALID_INDEX &&
-			expression[root.self()].type == term_t::Function;
-		if (brackets)
+		if (visited)
 		{
-			out << "(";
+			append_term(out, (*this)[idx]);
+			if (is_function(idx))
+			{
+				s.emplace_back(idx + nodes_[idx].payload, false);
+			}
+			continue;
 		}
 
-		f(out, subtree(root.left()), expression);
-		out << expression[root.self()].to_string();
-		f(out, subtree(root.right()), expression);
-
+		const bool brackets = idx != 0 && is_function(idx);
 		if (brackets)
 		{
-			out << ")";
+			out += '(';
+			s.emplace_back(CLOSE_BRACKET, false);
 		}
 
-		return;
-	};
-
-	f(ss, subtree(0), *this);
-	representation_ = std::move(ss.str());
-	modified_ = false;
-}
-
-
-std::string Expression::to_string() noexcept
-{
-	if (modified_)
-	{
-		recalculate_representation();
+		s.emplace_back(idx, true);
+		if (is_function(idx))
+		{
+			s.emplace_back(idx + 1, false);
+		}
 	}
 
-	return representation_;
+	return out;
 }
 
 
@@ -294,9 +328,9 @@ value_t Expression::max_value() const noexcept
 	// find max value in variables
 	for (const auto &node : nodes_)
 	{
-		if (node.term.type == term_t::Variable)
+		if (tag_type(node.tag) == term_t::Variable)
 		{
-			value = std::max(value, node.term.value);
+			value = std::max(value, node.payload);
 		}
 	}
 
@@ -311,9 +345,9 @@ value_t Expression::min_value() const noexcept
 	// find min value in variables
 	for (const auto &node : nodes_)
 	{
-		if (node.term.type == term_t::Variable)
+		if (tag_type(node.tag) == term_t::Variable)
 		{
-			min_value = std::min(min_value, node.term.value);
+			min_value = std::min(min_value, node.payload);
 		}
 	}
 
@@ -321,96 +355,137 @@ value_t Expression::min_value() const noexcept
 }
 
 
-void Expression::normalize() noexcept
+std::uint64_t Expression::hash() const noexcept
 {
-	std::vector<value_t> order;
-	std::unordered_map<value_t, value_t> remapping;
+	if (empty())
+	{
+		return 0;
+	}
+
+	// variables are hashed by order of first occurrence,
+	// so hash is the same as of normalized expression
+	const auto min = min_value();
+	SmallVector<value_t, EXPRESSION_INLINE_NODES> remapping;
+	remapping.resize(static_cast<std::size_t>(std::max(max_value() - min, 0)) + 1, 0);
 
-	std::function<void(Relation)> traverse =
-	[&] (Relation node)
+	value_t new_value = 1;
+	for (const auto &node : nodes_)
 	{
-		if (node.self() == INVALID_INDEX)
+		if (tag_type(node.tag) == term_t::Variable && remapping[node.payload - min] == 0)
 		{
-			return;
+			remapping[node.payload - min] = new_value++;
 		}
+	}
 
-		traverse(subtree(node.left()));
+	// children follow parents in preorder layout
+	SmallVector<std::uint64_t, EXPRESSION_INLINE_NODES> hashes;
+	hashes.resize(nodes_.size(), 0);
+	for (std::size_t idx = nodes_.size(); idx-- > 0;)
+	{
+		auto term = (*this)[idx];
+		std::uint64_t left = 0;
+		std::uint64_t right = 0;
 
-		if (nodes_[node.self()].term.type == term_t::Variable)
+		if (term.type == term_t::Variable)
 		{
-			order.push_back(nodes_[node.self()].term.value);
+			term.value = remapping[term.value - min];
 		}
-
-		traverse(subtree(node.right()));
-	};
-	traverse(subtree(0));
-
-	value_t new_value = 1;
-	for (const auto &entry : order)
-	{
-		if (remapping.contains(entry))
+		else if (term.type == term_t::Function)
 		{
-			continue;
+			left = hashes[idx + 1];
+			right = hashes[idx + nodes_[idx].payload];
 		}
 
-		remapping[entry] = new_value;
-		++new_value;
+		hashes[idx] = node_hash(term.type, term.op, term.value, left, right);
+	}
+
+	return hashes[0];
+}
+
+
+void Expression::normalize() noexcept
+{
+	if (empty())
+	{
+		return;
 	}
 
+	// leaves of preorder layout are in the same order as in inorder one
+	const auto min = min_value();
+	std::vector<value_t> remapping(
+		static_cast<std::size_t>(std::max(max_value() - min, 0)) + 1,
+		0
+	);
+
+	value_t new_value = 1;
 	for (auto &node : nodes_)
 	{
-		if (node.term.type != term_t::Variable)
+		if (tag_type(node.tag) != term_t::Variable)
 		{
 			continue;
 		}
 
-		node.term.value = remapping[node.term.value];
-	}
+		auto &value = remapping[node.payload - min];
+		if (value == 0)
+		{
+			value = new_value++;
+		}
 
-	modified_ = true;
+		node.payload = value;
+	}
 }
 
 
 void Expression::standardize() noexcept
 {
-	// bfs traverse
-	std::queue<std::size_t> q;
-	q.push(0);
+	if (empty())
+	{
+		return;
+	}
+
+	// `a | b` ~ `!a > b`, negation of left subtree is postponed
+	// until it's visited, so every node is visited once
+	std::vector<std::pair<std::size_t, bool>> s;
+	s.emplace_back(0, false);
 
-	while (!q.empty())
+	while (!s.empty())
 	{
-		const auto node_idx = q.front();
-		q.pop();
+		const auto [idx, negated] = s.back();
+		s.pop_back();
 
-		// skip invalid nodes
-		if (node_idx == INVALID_INDEX)
-		{
-			continue;
-		}
+		auto op = tag_op(nodes_[idx].tag);
 
-		if (nodes_[node_idx].term.type != term_t::Function)
+		if (!is_function(idx))
 		{
+			if (negated)
+			{
+				set_op(idx, op == operation_t::Negation ?
+					operation_t::Nop :
+					operation_t::Negation);
+			}
 			continue;
 		}
 
-		if (nodes_[node_idx].term.op == operation_t::Disjunction)
+		bool negate_left = false;
+		bool negate_right = false;
+		if (negated)
 		{
-			nodes_[node_idx].term.op = operation_t::Implication;
-			negation(subtree(node_idx).left());
+			const auto negation = negate_operation(op);
+			op = negation.op;
+			negate_left = negation.left;
+			negate_right = negation.right;
 		}
 
-		// continue standartization if required
-		if (has_left(node_idx))
+		if (op == operation_t::Disjunction)
 		{
-			q.push(subtree(node_idx).left());
+			op = operation_t::Implication;
+			negate_left = true;
 		}
-		if (has_right(node_idx))
-		{
-			q.push(subtree(node_idx).right());
-		}
-	}
 
-	modified_ = true;
+		set_op(idx, op);
+		s.emplace_back(idx + nodes_[idx].payload, negate_right);
+		s.emplace_back(idx + 1, negate_left);
+	}
 }
 
 
@@ -418,66 +493,41 @@ void Expression::make_permanent() noexcept
 {
 	for (auto &node : nodes_)
 	{
-		if (node.term.type == term_t::Variable)
+		if (tag_type(node.tag) == term_t::Variable)
 		{
-			node.term.type = term_t::Constant;
+			node.tag = pack_tag(term_t::Constant, tag_op(node.tag));
 		}
 	}
-
-	modified_ = true;
 }
 
 
 Relation Expression::subtree(std::size_t idx) const noexcept
 {
-	return in_range(idx) ? nodes_[idx].rel : Relation{};
-}
-
-
-Expression Expression::subtree_copy(std::size_t idx) const noexcept
-{
-	std::size_t new_root_index = subtree(idx).self();
-	std::vector<Node> nodes;
-	std::unordered_map<std::size_t, std::size_t> remapping;
-	std::size_t i = 0;
-
-	std::function<void(Relation)> traverse =
-	[&] (Relation node)
+	if (!in_range(idx))
 	{
-		if (node.self() == INVALID_INDEX)
-		{
-			return;
-		}
-
-		// append new node
-		nodes.push_back(nodes_[node.self()]);
-		remapping[node.self()] = i++;
+		return Relation{};
+	}
 
-		traverse(subtree(node.left()));
-		traverse(subtree(node.right()));
-	};
+	if (!is_function(idx))
+	{
+		return Relation{idx};
+	}
 
-	// traverse to collect values of subtree
-	traverse(subtree(new_root_index));
+	return Relation{idx, idx + 1, idx + nodes_[idx].payload};
+}
 
-	// break relation with old parent
-	nodes[0].rel.refs[3] = INVALID_INDEX;
 
-	// update indices
-	for (auto &node : nodes)
+Expression Expression::subtree_copy(std::size_t idx) const noexcept
+{
+	if (!in_range(idx))
 	{
-		for (auto &ref : node.rel.refs)
-		{
-			if (!remapping.contains(ref))
-			{
-				continue;
-			}
-
-			ref = remapping.at(ref);
-		}
+		return {};
 	}
 
-	return Expression{std::move(nodes)};
+	// subtree is contiguous and offsets are relative
+	Expression result;
+	result.nodes_.assign(nodes_.begin() + idx, nodes_.begin() + end(idx));
+	return result;
 }
 
 
@@ -491,13 +541,13 @@ bool Expression::contains(Term term) const noexcept
 
 	for (const auto &node : nodes_)
 	{
-		if (node.term.type != term_t::Variable &&
-			node.term.type != term_t::Constant)
+		const auto type = tag_type(node.tag);
+		if (type != term_t::Variable && type != term_t::Constant)
 		{
 			continue;
 		}
 
-		if (node.term.value == term.value)
+		if (node.payload == term.value)
 		{
 			return true;
 		}
@@ -509,13 +559,13 @@ bool Expression::contains(Term term) const noexcept
 
 bool Expression::has_left(std::size_t idx) const noexcept
 {
-	return !in_range(idx) ? false : in_range(nodes_[idx].rel.left());
+	return in_range(idx) && is_function(idx);
 }
 
 
 bool Expression::has_right(std::size_t idx) const noexcept
 {
-	return !in_range(idx) ? false : in_range(nodes_[idx].rel.right());
+	return in_range(idx) && is_function(idx);
 }
 
 
@@ -526,48 +576,39 @@ void Expression::negation(std::size_t idx)
 		return;
 	}
 
-	// bfs traverse
-	std::queue<std::size_t> q;
-	q.push(idx);
+	std::vector<std::size_t> s;
+	s.push_back(idx);
 
-	while (!q.empty())
+	while (!s.empty())
 	{
-		const auto node_idx = q.front();
-		q.pop();
+		const auto node_idx = s.back();
+		s.pop_back();
 
-		// skip invalid nodes
-		if (node_idx == INVALID_INDEX)
-		{
-			continue;
-		}
+		const auto op = tag_op(nodes_[node_idx].tag);
 
-		if (nodes_[node_idx].term.type != term_t::Function)
+		if (!is_function(node_idx))
 		{
-			nodes_[node_idx].term.op =
-				nodes_[node_idx].term.op == operation_t::Negation ?
+			set_op(node_idx, op == operation_t::Negation ?
 				operation_t::Nop :
-				operation_t::Negation;
+				operation_t::Negation);
 
 			continue;
 		}
 
-		// inverse operation_t
-		nodes_[node_idx].term.op = opposite(nodes_[node_idx].term.op);
+		// continue negation if required, !(a|b) = !a*!b
+		const auto negation = negate_operation(op);
+		set_op(node_idx, negation.op);
 
-		// continue negation if required
-		if (nodes_[node_idx].term.op == operation_t::Implication ||
-			nodes_[node_idx].term.op == operation_t::Conjunction)
+		if (negation.right)
 		{
-			q.push(subtree(node_idx).right());
+			s.push_back(node_idx + nodes_[node_idx].payload);
 		}
-		else if (nodes_[node_idx].term.op == operation_t::Disjunction)
+
+		if (negation.left)
 		{
-			q.push(subtree(node_idx).left());
-			q.push(subtree(node_idx).right());
+			s.push_back(node_idx + 1);
 		}
 	}
-
-	modified_ = true;
 }
 
 
@@ -577,13 +618,11 @@ void Expression::change_variables(value_t bound)
 	bound -= min_value();
 	for (auto &node : nodes_)
 	{
-		if (node.term.type == term_t::Variable)
+		if (tag_type(node.tag) == term_t::Variable)
 		{
-			node.term.value += bound;
+			node.payload += bound;
 		}
 	}
-
-	modified_ = true;
 }
 
 
@@ -594,85 +633,41 @@ Expression &Expression::replace(value_t value, const Expression &expression)
 		return *this;
 	}
 
-	std::vector<std::size_t> indices;
-	Expression new_expr = expression;
-	Expression new_expr_neg = new_expr;
-	new_expr_neg.negation();
-
-	value_t appropriate_value = 0;
-
-	// find all places
-	for (const auto &node : nodes_)
-	{
-		if (node.term.type == term_t::Variable &&
-			node.term.value == value)
-		{
-			indices.push_back(node.rel.self());
-			appropriate_value = std::max(
-				std::abs(appropriate_value),
-				node.term.value
-			);
-		}
-	}
+	const bool found = std::ranges::any_of(nodes_, [&] (const auto &node) {
+		return tag_type(node.tag) == term_t::Variable && node.payload == value;
+	});
 
 	// nothing to replace
-	if (indices.empty())
+	if (!found)
 	{
 		return *this;
 	}
 
-	// don't forget that other variables are different and should not intersect with ours
-	auto offset = size();
-	appropriate_value = appropriate_value + 1;
-	for (const auto &entry : indices)
-	{
-		auto replacement =
-			nodes_[entry].term.op == operation_t::Negation ?
-			new_expr_neg :
-			new_expr;
-
-		nodes_[entry] = Node{
-			replacement.nodes_[0].term,
-			Relation{
-				nodes_[entry].rel.refs[0],
-				increase_index(
-					replacement.subtree(0).left(),
-					offset - 1
-				),
-				increase_index(
-					replacement.subtree(0).right(),
-					offset - 1
-				),
-				nodes_[entry].rel.refs[3]
-			}
-		};
+	Expression negated = expression;
+	negated.negation();
 
-		for (std::size_t i = 1; i < replacement.nodes_.size(); ++i)
-		{
-			nodes_.push_back(replacement.nodes_[i]);
-			//nodes_.back().term.value += appropriate_value;
+	// offsets of functions are changed, so layout is built again
+	std::vector<Term> preorder;
+	preorder.reserve(nodes_.size() + expression.size());
 
-			for (auto &ref : nodes_.back().rel.refs)
-			{
-				ref = increase_index(ref, offset - 1);
-			}
-		}
+	for (std::size_t idx = 0; idx < nodes_.size(); ++idx)
+	{
+		const auto term = (*this)[idx];
 
-		// update relations for subroot nodes
-		if (subtree(entry).left() != INVALID_INDEX)
+		if (term.type != term_t::Variable || term.value != value)
 		{
-			nodes_[subtree(entry).left()].rel.refs[3] = entry;
+			preorder.push_back(term);
+			continue;
 		}
-		if (subtree(entry).right() != INVALID_INDEX)
+
+		const auto &replacement = term.op == operation_t::Negation ? negated : expression;
+		for (std::size_t i = 0; i < replacement.size(); ++i)
 		{
-			nodes_[subtree(entry).right()].rel.refs[3] = entry;
+			preorder.push_back(replacement[i]);
 		}
-
-		// mode offset
-		offset = nodes_.size();
 	}
 
-	modified_ = true;
+	*this = Expression{preorder};
 	return *this;
 }
 
@@ -683,46 +678,18 @@ Expression Expression::construct(
 	const Expression &rhs
 )
 {
+	// offsets are relative, so subtrees are copied as is
 	Expression expression;
-	std::size_t offset = 1;
-
-	expression.nodes_.emplace_back(
-		Term(term_t::Function, op),
-		Relation(0, 1, 1 + lhs.size())
-	);
-
-	for (const auto &node : lhs.nodes_)
-	{
-		expression.nodes_.push_back(node);
+	expression.nodes_.reserve(1 + lhs.size() + rhs.size());
 
-		for (auto &ref : expression.nodes_.back().rel.refs)
-		{
-			ref = increase_index(ref, offset);
-		}
+	expression.nodes_.push_back({
+		pack_tag(term_t::Function, op),
+		static_cast<std::int32_t>(1 + lhs.size())
+	});
 
-		if (expression.nodes_.back().rel.refs[3] == INVALID_INDEX)
-		{
-			expression.nodes_.back().rel.refs[3] = 0;
-		}
-	}
+	expression.nodes_.append(lhs.nodes_.begin(), lhs.nodes_.end());
+	expression.nodes_.append(rhs.nodes_.begin(), rhs.nodes_.end());
 
-	offset += lhs.size();
-	for (const auto &node : rhs.nodes_)
-	{
-		expression.nodes_.push_back(node);
-
-		for (auto &ref : expression.nodes_.back().rel.refs)
-		{
-			ref = increase_index(ref, offset);
-		}
-
-		if (expression.nodes_.back().rel.refs[3] == INVALID_INDEX)
-		{
-			expression.nodes_.back().rel.refs[3] = 0;
-		}
-	}
-
-	expression.modified_ = true;
 	return expression;
 }
 
@@ -739,28 +706,23 @@ bool Expression::equals(const Expression &other, bool var_ignore) const noexcept
 		return false;
 	}
 
+	// preorder sequences of terms are equal iff trees are equal
 	for (std::size_t i = 0; i < size(); ++i)
 	{
-		if ((nodes_[i].term.type == term_t::Function) !=
-			(other.nodes_[i].term.type == term_t::Function))
-		{
-			return false;
-		}
+		const auto lhs = (*this)[i];
+		const auto rhs = other[i];
 
-		if (nodes_[i].term.type == term_t::Function &&
-			nodes_[i].term.op != other.nodes_[i].term.op)
+		if ((lhs.type == term_t::Function) != (rhs.type == term_t::Function))
 		{
 			return false;
 		}
 
-		if (!var_ignore &&
-			(nodes_[i].term.type != other.nodes_[i].term.type))
+		if (!var_ignore && lhs.type != rhs.type)
 		{
 			return false;
 		}
 
-		if (nodes_[i].term.value != other.nodes_[i].term.value ||
-			nodes_[i].term.op != other.nodes_[i].term.op)
+		if (lhs.value != rhs.value || lhs.op != rhs.op)
 		{
 			return false;
 		}
@@ -770,7 +732,7 @@ bool Expression::equals(const Expression &other, bool var_ignore) const noexcept
 }
 
 
-std::ostream &operator<<(std::ostream &out, Expression &expression)
+std::ostream &operator<<(std::ostream &out, const Expression &expression)
 {
 	return out << expression.to_string();
 }
@@ -6,7 +6,15 @@
 #include <algorithm>
 #include <vector>
 #include <array>
+#include <span>
 #include <string>
+#include "small_vector.hpp"
+
+
+// nodes of expression stored without heap allocation
+#ifndef EXPRESSION_INLINE_NODES
+#define EXPRESSION_INLINE_NODES 24
+#endif
 
 
 using value_t = std::int32_t;
@@ -63,8 +71,32 @@ inline bool is_commutative(operation_t operation_t)
 operation_t opposite(operation_t operation);
 
 
-std::size_t increase_index(std::size_t index, std::size_t offset);
-std::size_t decrease_index(std::size_t index, std::size_t offset);
+/**
+ * @brief function node after one negation: its operation and which
+ * operands are negated, !(a|b) = !a*!b, !(a*b) = a>!b, !(a>b) = a*!b
+ * @note every negation of function node is done through it
+ */
+struct NegatedOperation
+{
+	operation_t op;
+	bool left;
+	bool right;
+};
+
+NegatedOperation negate_operation(operation_t operation);
+
+
+/**
+ * @brief structural hash of node combined from hashes of its subtrees
+ * @note empty subtree has hash 0
+ */
+std::uint64_t node_hash(
+	term_t type,
+	operation_t op,
+	value_t value,
+	std::uint64_t left,
+	std::uint64_t right
+) noexcept;
 
 
 struct Term
@@ -83,48 +115,86 @@ struct Term
 };
 
 
+/**
+ * @brief type and operation of term packed into one byte
+ */
+constexpr std::uint8_t pack_tag(term_t type, operation_t op) noexcept
+{
+	return static_cast<std::uint8_t>(
+		static_cast<std::uint8_t>(type) << 3 |
+		static_cast<std::uint8_t>(op)
+	);
+}
+
+
+constexpr term_t tag_type(std::uint8_t tag) noexcept
+{
+	return static_cast<term_t>(tag >> 3);
+}
+
+
+constexpr operation_t tag_op(std::uint8_t tag) noexcept
+{
+	return static_cast<operation_t>(tag & 0x7);
+}
+
+
 struct Relation
 {
-	// references to self,left,right,parent
-	std::array<std::size_t, 4> refs;
+	// references to self,left,right
+	std::array<std::size_t, 3> refs;
 
 	Relation(std::size_t self = INVALID_INDEX,
 		std::size_t left = INVALID_INDEX,
-		std::size_t right = INVALID_INDEX,
-		std::size_t parent = INVALID_INDEX) noexcept
-		: refs{self, left, right, parent}
+		std::size_t right = INVALID_INDEX) noexcept
+		: refs{self, left, right}
 	{}
 
 	inline std::size_t self() const noexcept { return refs[0]; }
 	inline std::size_t left() const noexcept { return refs[1]; }
 	inline std::size_t right() const noexcept { return refs[2]; }
-	inline std::size_t parent() const noexcept { return refs[3]; }
 };
 
 
 class Expression
 {
+	friend class TermStore;
+
+	/**
+	 * @brief node of preorder layout
+	 *
+	 * @note left child of function is the next node, so only offset
+	 * of right child is stored, parent and self are not stored at all
+	 */
 	struct Node
 	{
-		Term term;
-		Relation rel;
+		std::uint8_t tag;
 
-		Node(const Term &term, const Relation &rel) noexcept
-			: term(term), rel(rel)
-		{}
+		// value of leaf or offset of right child of function
+		std::int32_t payload;
 	};
+	static_assert(sizeof(Node) == 8);
 
 private:
-	std::vector<Node> nodes_;
-	std::string representation_;
-	bool modified_ = true;
+	SmallVector<Node, EXPRESSION_INLINE_NODES> nodes_;
 
 	inline bool in_range(std::size_t index) const noexcept
 	{
 		return index < nodes_.size();
 	}
 
-	void recalculate_representation() noexcept;
+	inline bool is_function(std::size_t idx) const noexcept
+	{
+		return tag_type(nodes_[idx].tag) == term_t::Function;
+	}
+
+	inline void set_op(std::size_t idx, operation_t op) noexcept
+	{
+		nodes_[idx].tag = pack_tag(tag_type(nodes_[idx].tag), op);
+	}
+
+	// index after the last node of subtree `idx`
+	std::size_t end(std::size_t idx) const noexcept;
 public:
 	// construction
 	Expression();
@@ -132,8 +202,9 @@ public:
 	Expression(Term term);
 	Expression(const Expression &other);
 	Expression(Expression &&other);
-	Expression(const std::vector<Node> &nodes);
-	Expression(std::vector<Node> &&nodes);
+
+	// preorder sequence of terms, every function has two children
+	explicit Expression(std::span<const Term> preorder);
 	Expression &operator=(const Expression &other);
 	Expression &operator=(Expression &&other);
 
@@ -144,9 +215,14 @@ public:
 	std::size_t operations(operation_t op) const noexcept;
 	std::vector<value_t> variables() const noexcept;
 
-	inline Term &operator[](std::size_t idx) { return nodes_[idx].term; }
- 	inline const Term &operator[](std::size_t idx) const { return nodes_[idx].term; }
-	std::string to_string() noexcept;
+	// terms are packed, so they are returned by value
+	inline Term operator[](std::size_t idx) const
+	{
+		const auto &node = nodes_[idx];
+		const auto type = tag_type(node.tag);
+		return Term(type, tag_op(node.tag), type == term_t::Function ? 0 : node.payload);
+	}
+	std::string to_string() const noexcept;
 
 	// max variable value
 	value_t max_value() const noexcept;
@@ -154,6 +230,9 @@ public:
 	// min variable value
 	value_t min_value() const noexcept;
 
+	// variable renaming invariant structural hash
+	std::uint64_t hash() const noexcept;
+
 	// expression normalization
 	void normalize() noexcept;
 	void standardize() noexcept;
@@ -196,6 +275,6 @@ public:
 };
 
 
-std::ostream &operator<<(std::ostream &out, Expression &expression);
+std::ostream &operator<<(std::ostream &out, const Expression &expression);
 
 #endif // AST_HPP
@@ -0,0 +1,283 @@
+#include <stack>
+#include "discrimination_tree.hpp"
+
+
+constexpr const std::uint32_t INVALID_NODE = static_cast<std::uint32_t>(-1);
+
+
+DiscriminationTree::DiscriminationTree()
+	: nodes_(1)
+	, size_(0)
+{}
+
+
+DiscriminationTree::symbol_t DiscriminationTree::symbol(const Term &term) noexcept
+{
+	// all variables are the same wildcard
+	if (term.type == term_t::Variable)
+	{
+		return static_cast<symbol_t>(term_t::Variable) << 40;
+	}
+
+	// negation of constant is significant, negation of function is impossible
+	return static_cast<symbol_t>(term.type) << 40 |
+		static_cast<symbol_t>(term.op) << 32 |
+		static_cast<std::uint32_t>(term.value);
+}
+
+
+std::size_t DiscriminationTree::arity(symbol_t symbol) noexcept
+{
+	return (symbol >> 40) == static_cast<symbol_t>(term_t::Function) ? 2 : 0;
+}
+
+
+void DiscriminationTree::flatten(
+	const TermStore &store,
+	term_id id,
+	std::vector<symbol_t> &symbols,
+	std::vector<std::size_t> &next
+)
+{
+	symbols.clear();
+	next.clear();
+
+	std::stack<term_id> s;
+	s.push(id);
+
+	while (!s.empty())
+	{
+		const auto current = s.top();
+		s.pop();
+
+		symbols.push_back(symbol(store.term(current)));
+
+		// subtree of preorder position `i` ends at `i + size`
+		next.push_back(symbols.size() - 1 + store.size(current));
+
+		if (store.right(current) != INVALID_TERM)
+		{
+			s.push(store.right(current));
+		}
+		if (store.left(current) != INVALID_TERM)
+		{
+			s.push(store.left(current));
+		}
+	}
+}
+
+
+std::uint32_t DiscriminationTree::child(std::uint32_t node, symbol_t symbol) const noexcept
+{
+	for (const auto &[s, idx] : nodes_[node].children)
+	{
+		if (s == symbol)
+		{
+			return idx;
+		}
+	}
+
+	return INVALID_NODE;
+}
+
+
+void DiscriminationTree::insert(const TermStore &store, term_id key, std::uint32_t value)
+{
+	if (key == INVALID_TERM)
+	{
+		return;
+	}
+
+	std::vector<symbol_t> symbols;
+	std::vector<std::size_t> next;
+	flatten(store, key, symbols, next);
+
+	std::uint32_t node = 0;
+	for (const auto &sym : symbols)
+	{
+		auto idx = child(node, sym);
+
+		if (idx == INVALID_NODE)
+		{
+			idx = static_cast<std::uint32_t>(nodes_.size());
+			nodes_[node].children.emplace_back(sym, idx);
+			nodes_.emplace_back();
+		}
+
+		node = idx;
+	}
+
+	nodes_[node].values.push_back(value);
+	++size_;
+}
+
+
+void DiscriminationTree::skip(
+	Retrieval mode,
+	std::uint32_t node,
+	std::size_t count,
+	std::size_t position,
+	const std::vector<symbol_t> &symbols,
+	const std::vector<std::size_t> &next,
+	std::vector<std::uint32_t> &result
+) const
+{
+	if (count == 0)
+	{
+		retrieve(mode, node, position, symbols, next, result);
+		return;
+	}
+
+	for (const auto &[sym, idx] : nodes_[node].children)
+	{
+		skip(mode, idx, count - 1 + arity(sym), position, symbols, next, result);
+	}
+}
+
+
+void DiscriminationTree::retrieve(
+	Retrieval mode,
+	std::uint32_t node,
+	std::size_t position,
+	const std::vector<symbol_t> &symbols,
+	const std::vector<std::size_t> &next,
+	std::vector<std::uint32_t> &result
+) const
+{
+	if (position == symbols.size())
+	{
+		result.insert(
+			result.end(),
+			nodes_[node].values.begin(),
+			nodes_[node].values.end()
+		);
+		return;
+	}
+
+	const auto sym = symbols[position];
+
+	// variable of query may be unified with any subtree of key
+	if ((sym >> 40) == static_cast<symbol_t>(term_t::Variable) &&
+		mode != Retrieval::Generalizations)
+	{
+		skip(mode, node, 1, position + 1, symbols, next, result);
+		return;
+	}
+
+	for (const auto &[s, idx] : nodes_[node].children)
+	{
+		// variable of key may be unified with whole subtree of query
+		if ((s >> 40) == static_cast<symbol_t>(term_t::Variable) &&
+			mode != Retrieval::Instances)
+		{
+			retrieve(mode, idx, next[position], symbols, next, result);
+		}
+		else if (s == sym)
+		{
+			retrieve(mode, idx, position + 1, symbols, next, result);
+		}
+	}
+}
+
+
+void DiscriminationTree::collect(
+	Retrieval mode,
+	const TermStore &store,
+	term_id query,
+	std::vector<std::uint32_t> &result
+) const
+{
+	if (query == INVALID_TERM)
+	{
+		return;
+	}
+
+	std::vector<symbol_t> symbols;
+	std::vector<std::size_t> next;
+	flatten(store, query, symbols, next);
+
+	retrieve(mode, 0, 0, symbols, next, result);
+}
+
+
+void DiscriminationTree::retrieve_unifiable(
+	const TermStore &store,
+	term_id query,
+	std::vector<std::uint32_t> &result
+) const
+{
+	collect(Retrieval::Unifiable, store, query, result);
+}
+
+
+void DiscriminationTree::retrieve_unifiable(
+	std::span<const Term> query,
+	std::vector<std::uint32_t> &result
+) const
+{
+	if (query.empty())
+	{
+		return;
+	}
+
+	std::vector<symbol_t> symbols(query.size());
+	std::vector<std::size_t> next(query.size());
+
+	// in reverse preorder sizes of both children are on top of stack
+	std::vector<std::size_t> sizes;
+	for (auto i = query.size(); i-- > 0;)
+	{
+		symbols[i] = symbol(query[i]);
+
+		std::size_t size = 1;
+		if (query[i].type == term_t::Function)
+		{
+			size += sizes.back();
+			sizes.pop_back();
+			size += sizes.back();
+			sizes.pop_back();
+		}
+
+		sizes.push_back(size);
+		next[i] = i + size;
+	}
+
+	retrieve(Retrieval::Unifiable, 0, 0, symbols, next, result);
+}
+
+
+void DiscriminationTree::retrieve_generalizations(
+	const TermStore &store,
+	term_id query,
+	std::vector<std::uint32_t> &result
+) const
+{
+	collect(Retrieval::Generalizations, store, query, result);
+}
+
+
+void DiscriminationTree::retrieve_instances(
+	const TermStore &store,
+	term_id query,
+	std::vector<std::uint32_t> &result
+) const
+{
+	collect(Retrieval::Instances, store, query, result);
+}
+
+
+std::size_t DiscriminationTree::memory() const noexcept
+{
+	// every node but root is a child of one node, every value is stored once
+	return nodes_.capacity() * sizeof(Node) +
+		nodes_.size() * sizeof(std::pair<symbol_t, std::uint32_t>) +
+		size_ * sizeof(std::uint32_t);
+}
+
+
+void DiscriminationTree::clear() noexcept
+{
+	nodes_.clear();
+	nodes_.emplace_back();
+	size_ = 0;
+}
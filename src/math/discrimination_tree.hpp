@@ -0,0 +1,121 @@
+#ifndef DISCRIMINATION_TREE_HPP
+#define DISCRIMINATION_TREE_HPP
+
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <utility>
+#include "term_store.hpp"
+
+
+/**
+ * @brief imperfect discrimination tree over stored expressions
+ *
+ * @note keys are preorder symbol sequences where every variable
+ * (regardless of negation) is replaced with a wildcard, so retrieval
+ * returns superset of values whose keys are unifiable with query
+ * (or are generalizations or instances of it)
+ */
+class DiscriminationTree
+{
+	using symbol_t = std::uint64_t;
+
+	// which variables may be matched with whole subtree of other side
+	enum class Retrieval
+	{
+		Unifiable,
+		Generalizations,
+		Instances
+	};
+
+	struct Node
+	{
+		std::vector<std::pair<symbol_t, std::uint32_t>> children;
+		std::vector<std::uint32_t> values;
+	};
+
+	std::vector<Node> nodes_;
+	std::size_t size_;
+
+	static symbol_t symbol(const Term &term) noexcept;
+	static std::size_t arity(symbol_t symbol) noexcept;
+
+	// preorder symbols of expression and index after each subtree
+	static void flatten(
+		const TermStore &store,
+		term_id id,
+		std::vector<symbol_t> &symbols,
+		std::vector<std::size_t> &next
+	);
+
+	std::uint32_t child(std::uint32_t node, symbol_t symbol) const noexcept;
+
+	void retrieve(
+		Retrieval mode,
+		std::uint32_t node,
+		std::size_t position,
+		const std::vector<symbol_t> &symbols,
+		const std::vector<std::size_t> &next,
+		std::vector<std::uint32_t> &result
+	) const;
+
+	// skip `count` whole subtrees starting at `node`
+	void skip(
+		Retrieval mode,
+		std::uint32_t node,
+		std::size_t count,
+		std::size_t position,
+		const std::vector<symbol_t> &symbols,
+		const std::vector<std::size_t> &next,
+		std::vector<std::uint32_t> &result
+	) const;
+
+	void collect(
+		Retrieval mode,
+		const TermStore &store,
+		term_id query,
+		std::vector<std::uint32_t> &result
+	) const;
+public:
+	DiscriminationTree();
+
+	void insert(const TermStore &store, term_id key, std::uint32_t value);
+
+	/**
+	 * @brief collect values of keys which may be unified with `query`
+	 * @note values are appended to `result` in no particular order
+	 */
+	void retrieve_unifiable(
+		const TermStore &store,
+		term_id query,
+		std::vector<std::uint32_t> &result
+	) const;
+
+	// same for preorder sequence of terms which isn't stored
+	void retrieve_unifiable(
+		std::span<const Term> query,
+		std::vector<std::uint32_t> &result
+	) const;
+
+	// collect values of keys which `query` may be an instance of
+	void retrieve_generalizations(
+		const TermStore &store,
+		term_id query,
+		std::vector<std::uint32_t> &result
+	) const;
+
+	// collect values of keys which may be instances of `query`
+	void retrieve_instances(
+		const TermStore &store,
+		term_id query,
+		std::vector<std::uint32_t> &result
+	) const;
+
+	void clear() noexcept;
+	inline std::size_t size() const noexcept { return size_; }
+
+	// approximate bytes of heap memory held by tree
+	std::size_t memory() const noexcept;
+};
+
+#endif // DISCRIMINATION_TREE_HPP
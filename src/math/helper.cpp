@@ -2,217 +2,376 @@
 #include <queue>
 #include <iostream>
 #include <stack>
+#include <tuple>
+#include <algorithm>
 #include "helper.hpp"
+#include "arena.hpp"
 
 
-void topological_sort_util(
-	value_t v,
-	std::vector<std::vector<value_t>> &adj,
-	std::vector<bool> &visited,
-	std::stack<value_t> &s
+bool unification(
+	Expression left,
+	Expression right,
+	std::unordered_map<value_t, Expression> &substitution
 )
 {
-	visited[v] = true;
+	TermStore store;
+	Arena arena(1 << 12);
+
+	// variables of `right` start right after the ones of `left`
+	right.change_variables(1);
+
+	const auto lhs = store.intern(left);
+	const auto rhs = store.intern(right);
+
+	Substitution sub(&arena);
+	if (!unification(store, lhs, rhs, sub))
+	{
+		return false;
+	}
 
-	for (value_t i : adj[v])
+	substitution.clear();
+	for (std::size_t key = 0; key < sub.size(); ++key)
 	{
-		if (!visited[i])
+		if (sub[key].term == INVALID_TERM)
 		{
-			topological_sort_util(i, adj, visited, s);
+			continue;
 		}
+
+		std::pmr::vector<Term> preorder(&arena);
+		instantiate(store, sub[key], sub, preorder);
+		substitution[static_cast<value_t>(key)] = Expression{preorder};
 	}
 
-	s.push(v);
+	return true;
 }
 
 
-std::vector<value_t> topological_sort(
-	std::vector<std::vector<value_t>> &adj,
-	value_t size
-)
+bool is_equal(Expression left, Expression right)
 {
-	std::stack<value_t> s;
-	std::vector<bool> visited(size, false);
-	std::vector<value_t> order;
+	// few O(1) checks
+	if (left.size() != right.size())
+	{
+		return false;
+	}
 
-	for (value_t i = 0; i < size; ++i)
+	if (left[0].op != right[0].op)
 	{
-		if (!visited[i])
-		{
-			topological_sort_util(i, adj, visited, s);
-		}
+		return false;
 	}
 
-	while (!s.empty())
+	left.normalize();
+	right.normalize();
+
+	return left.equals(right);
+}
+
+
+/**
+ * @brief term of stored expression as seen through `binding`
+ */
+Term view_term(const TermStore &store, const Binding &binding)
+{
+	auto term = store.term(binding.term);
+
+	if (!binding.negated)
+	{
+		return term;
+	}
+
+	if (term.type == term_t::Function)
+	{
+		term.op = negate_operation(term.op).op;
+	}
+	else
 	{
-		order.push_back(s.top());
-		s.pop();
+		term.op = term.op == operation_t::Negation ?
+			operation_t::Nop :
+			operation_t::Negation;
 	}
 
-	return order;
+	return term;
 }
 
 
-bool add_constraint(
-	Term term,
-	Expression substitution,
-	std::unordered_map<value_t, Expression> &sub
-)
+/**
+ * @brief children of stored expression as seen through `binding`
+ */
+Binding view_left(const TermStore &store, const Binding &binding)
+{
+	return {
+		store.left(binding.term),
+		binding.offset,
+		binding.negated && negate_operation(store.term(binding.term).op).left
+	};
+}
+
+
+Binding view_right(const TermStore &store, const Binding &binding)
 {
-	if (substitution[0].type == term_t::Function &&
-		substitution.contains(term))
+	return {
+		store.right(binding.term),
+		binding.offset,
+		binding.negated && negate_operation(store.term(binding.term).op).right
+	};
+}
+
+
+/**
+ * @brief binding of variable seen through `binding`, nullptr if it's not bound one
+ */
+const Binding *bound(const TermStore &store, const Binding &binding, const Substitution &sub)
+{
+	const auto &term = store.term(binding.term);
+	if (term.type != term_t::Variable)
 	{
-		return false;
+		return nullptr;
 	}
 
-	sub[term.value] = substitution;
-	return true;
+	const auto key = term.value + binding.offset;
+	if (static_cast<std::size_t>(key) >= sub.size() || sub[key].term == INVALID_TERM)
+	{
+		return nullptr;
+	}
+
+	return &sub[key];
 }
 
 
-bool unification(
-	Expression left,
-	Expression right,
-	std::unordered_map<value_t, Expression> &substitution
+/**
+ * @brief follow bindings of variable until unbound variable or other term
+ *
+ * @note `via` is set to the last bound variable on the way (or INVALID_TERM),
+ * every variable on the way is bound directly to the result afterwards
+ */
+Binding dereference(
+	const TermStore &store,
+	const Binding &binding,
+	Substitution &sub,
+	Binding &via
 )
 {
-	std::unordered_map<value_t, Expression> sub;
+	via = {INVALID_TERM, 0, false};
 
-	// change variables to avoid intersections
-	right.change_variables(left.max_value() + 1);
-	value_t v = right.max_value() + 1;
+	// !A = B <=> A = !B, so polarity is accumulated on every step
+	auto result = binding;
+	while (const auto *next = bound(store, result, sub))
+	{
+		const bool should_negate = view_term(store, result).op == operation_t::Negation;
 
-	// algorithm
-	// step 1: find the set of mismatches
-	// step 2: apply appropriate changes (if possible)
-	// goto 1
-	// mismatches can only be in `current`, `left` or `right` subtrees
-	// therefore we will use preorder tree traverse
+		via = result;
+		result = *next;
+		result.negated = result.negated != should_negate;
+	}
 
-	std::queue<std::pair<std::size_t, std::size_t>> expression;
-	expression.emplace(left.subtree(0).self(), right.subtree(0).self());
+	// path compression, every binding denotes the same term as `binding`
+	auto current = binding;
+	while (const auto *next = bound(store, current, sub))
+	{
+		const bool should_negate = view_term(store, current).op == operation_t::Negation;
+		const auto key = store.term(current.term).value + current.offset;
 
-	Expression lhs, rhs;
+		current = *next;
+		current.negated = current.negated != should_negate;
 
-	while (!expression.empty())
-	{
-		auto [left_idx, right_idx] = expression.front();
-		expression.pop();
+		sub[key] = result;
+		sub[key].negated = result.negated != should_negate;
+	}
 
-		auto left_term = left[left_idx];
-		auto right_term = right[right_idx];
+	return result;
+}
+
+
+/**
+ * @brief bind variable seen through `var` to term seen through `value`
+ */
+void bind(const TermStore &store, const Binding &var, Binding value, Substitution &sub)
+{
+	const auto term = view_term(store, var);
+
+	// !A = B <=> A := !B
+	value.negated = value.negated != (term.op == operation_t::Negation);
+	sub[term.value + var.offset] = value;
+}
 
-		// case 0: both terms are functions
-		if (left_term.type == term_t::Function &&
-			right_term.type == term_t::Function)
-		{
-			// it's impossible to unify different operations
-			if (left_term.op != right_term.op)
-			{
-				return false;
-			}
 
-			// add nodes to process
-			expression.emplace(
-				left.subtree(left_idx).left(),
-				right.subtree(right_idx).left()
-			);
-			expression.emplace(
-				left.subtree(left_idx).right(),
-				right.subtree(right_idx).right()
-			);
+/**
+ * @brief lazy occurs check, is there a variable which contains itself once substitution is applied?
+ * @note every binding is visited once, so it's linear in size of substitution
+ */
+bool is_cyclic(const TermStore &store, const Substitution &sub)
+{
+	enum class color_t : std::uint8_t { White, Gray, Black };
+
+	std::pmr::vector<color_t> colors(sub.size(), color_t::White, sub.get_allocator().resource());
+
+	// `key` is set for frames which finish visiting of variable
+	struct Frame
+	{
+		term_id id;
+		value_t offset;
+		value_t key;
+	};
+	std::pmr::vector<Frame> s(sub.get_allocator().resource());
+
+	for (std::size_t root = 0; root < sub.size(); ++root)
+	{
+		if (sub[root].term == INVALID_TERM || colors[root] != color_t::White)
+		{
 			continue;
 		}
 
-		lhs = std::move(left.subtree_copy(left_idx));
-		rhs = std::move(right.subtree_copy(right_idx));
+		colors[root] = color_t::Gray;
+		s.push_back({INVALID_TERM, 0, static_cast<value_t>(root)});
+		s.push_back({sub[root].term, sub[root].offset, 0});
 
-		// adjust terms since it may have subs
-		while (lhs[0].type == term_t::Variable &&
-			sub.contains(lhs[0].value))
+		while (!s.empty())
 		{
-			bool should_negate = lhs[0].op == operation_t::Negation;
+			const auto frame = s.back();
+			s.pop_back();
 
-			lhs = sub.at(lhs[0].value);
-			if (should_negate)
+			if (frame.id == INVALID_TERM)
 			{
-				lhs.negation();
+				colors[frame.key] = color_t::Black;
+				continue;
 			}
-		}
-		while (rhs[0].type == term_t::Variable &&
-			sub.contains(rhs[0].value))
-		{
-			bool should_negate = rhs[0].op == operation_t::Negation;
 
-			rhs = sub.at(rhs[0].value);
-			if (should_negate)
+			const auto &term = store.term(frame.id);
+
+			if (term.type == term_t::Function)
 			{
-				rhs.negation();
+				s.push_back({store.left(frame.id), frame.offset, 0});
+				s.push_back({store.right(frame.id), frame.offset, 0});
+				continue;
 			}
-		}
 
-		// case 1: both terms are constants
-		if (lhs[0].type == term_t::Constant &&
-			rhs[0].type == term_t::Constant)
-		{
-			// can't unify two constants
-			if (lhs[0] != rhs[0])
+			const auto key = term.value + frame.offset;
+			if (term.type != term_t::Variable || sub[key].term == INVALID_TERM)
 			{
-				return false;
+				continue;
 			}
 
-			// well, everything seems to be fine
-			continue;
-		}
+			if (colors[key] == color_t::Gray)
+			{
+				return true;
+			}
 
-		// case 2: left term is constant and right is variable
-		if (lhs[0].type == term_t::Constant &&
-			rhs[0].type == term_t::Variable)
-		{
-			if (rhs[0].op == operation_t::Negation)
+			if (colors[key] == color_t::White)
 			{
-				lhs[0].op =
-				lhs[0].op != operation_t::Negation ?
-				operation_t::Negation :
-				operation_t::Nop;
+				colors[key] = color_t::Gray;
+				s.push_back({INVALID_TERM, 0, key});
+				s.push_back({sub[key].term, sub[key].offset, 0});
 			}
+		}
+	}
+
+	return false;
+}
+
 
-			if (!add_constraint(rhs[0], lhs, sub))
+bool unification(
+	const TermStore &store,
+	term_id left,
+	term_id right,
+	Substitution &substitution
+)
+{
+	// variables of `right` are shifted to avoid intersections
+	const value_t offset = store.max_value(left);
+	const std::pair<Binding, Binding> equation(Binding{left, 0, false}, Binding{right, offset, false});
+
+	return unification(store, {&equation, 1}, offset + store.max_value(right), substitution);
+}
+
+
+bool unification(
+	const TermStore &store,
+	std::span<const std::pair<Binding, Binding>> equations,
+	value_t variables,
+	Substitution &substitution
+)
+{
+	auto &sub = substitution;
+	sub.assign(variables + 1, Binding{INVALID_TERM, 0, false});
+
+	std::pmr::vector<std::pair<Binding, Binding>> pairs(sub.get_allocator().resource());
+	std::size_t budget = 0;
+	for (const auto &[lhs, rhs] : equations)
+	{
+		budget += store.size(lhs.term) + store.size(rhs.term);
+	}
+
+	// the first equation is on top of stack, so it's unified first
+	pairs.reserve(budget);
+	pairs.insert(pairs.end(), equations.rbegin(), equations.rend());
+
+	Binding lhs_via;
+	Binding rhs_via;
+
+	// cyclic bindings may produce pairs forever, so occurs check is done
+	// once the work exceeds doubling budget and finally at the end
+	std::size_t steps = 0;
+
+	while (!pairs.empty())
+	{
+		if (++steps > budget)
+		{
+			if (is_cyclic(store, sub))
 			{
 				return false;
 			}
 
-			continue;
+			budget *= 2;
 		}
 
-		// case 3: left term is variable and right is constant
-		if (lhs[0].type == term_t::Variable &&
-			rhs[0].type == term_t::Constant)
+		// adjust terms since it may have subs
+		const auto lhs = dereference(store, pairs.back().first, sub, lhs_via);
+		const auto rhs = dereference(store, pairs.back().second, sub, rhs_via);
+		pairs.pop_back();
+
+		const auto lhs_term = view_term(store, lhs);
+		const auto rhs_term = view_term(store, rhs);
+
+		// case 0: both terms are functions
+		if (lhs_term.type == term_t::Function &&
+			rhs_term.type == term_t::Function)
 		{
-			if (lhs[0].op == operation_t::Negation)
+			// it's impossible to unify different operations
+			if (lhs_term.op != rhs_term.op)
 			{
-				rhs[0].op =
-				rhs[0].op != operation_t::Negation ?
-				operation_t::Negation :
-				operation_t::Nop;
+				return false;
 			}
 
-			if (!add_constraint(lhs[0], rhs, sub))
+			// both terms are values of variables, so variables are merged
+			// before children are unified and it's never done twice for them
+			if (lhs_via.term != INVALID_TERM && rhs_via.term != INVALID_TERM)
 			{
-				return false;
+				const auto lhs_key = store.term(lhs_via.term).value + lhs_via.offset;
+				const auto rhs_key = store.term(rhs_via.term).value + rhs_via.offset;
+
+				if (lhs_key == rhs_key)
+				{
+					continue;
+				}
+
+				bind(store, lhs_via, rhs_via, sub);
 			}
 
+			pairs.emplace_back(view_right(store, lhs), view_right(store, rhs));
+			pairs.emplace_back(view_left(store, lhs), view_left(store, rhs));
 			continue;
 		}
 
-		// case 4: both terms are variables
-		if (lhs[0].type == term_t::Variable &&
-			rhs[0].type == term_t::Variable)
+		// case 1: both terms are variables
+		if (lhs_term.type == term_t::Variable &&
+			rhs_term.type == term_t::Variable)
 		{
+			const auto lhs_key = lhs_term.value + lhs.offset;
+			const auto rhs_key = rhs_term.value + rhs.offset;
+
 			// are variables equal?
-			if (lhs[0].value == rhs[0].value)
+			if (lhs_key == rhs_key)
 			{
-				if (lhs[0].op != rhs[0].op)
+				if (lhs_term.op != rhs_term.op)
 				{
 					return false;
 				}
@@ -220,160 +379,240 @@ bool unification(
 				continue;
 			}
 
-			// add new variable
-			Expression expr(Term(
-				term_t::Variable,
-				lhs[0].op == operation_t::Negation ||
-				rhs[0].op == operation_t::Negation ?
-				operation_t::Negation :
-				operation_t::Nop,
-				v++
-			));
-			Expression neg_expr = expr;
-			neg_expr.negation();
-
-			if (lhs[0].op == operation_t::Negation)
-			{
-				add_constraint(lhs[0], neg_expr, sub);
-			}
-			else
-			{
-				add_constraint(lhs[0], expr, sub);
-			}
+			// variables of `right` are kept
+			bind(store, lhs, rhs, sub);
+			continue;
+		}
 
-			if (rhs[0].op == operation_t::Negation)
-			{
-				add_constraint(rhs[0], neg_expr, sub);
-			}
-			else
-			{
-				add_constraint(rhs[0], expr, sub);
-			}
+		// case 2: one of the terms is variable, occurs check is postponed
+		if (lhs_term.type == term_t::Variable)
+		{
+			bind(store, lhs, rhs, sub);
+			continue;
+		}
 
+		if (rhs_term.type == term_t::Variable)
+		{
+			bind(store, rhs, lhs, sub);
 			continue;
 		}
 
-		// case 5: left term is function
-		if (lhs[0].type == term_t::Function)
+		// case 3: both terms are constants
+		if (lhs_term.type == term_t::Constant &&
+			rhs_term.type == term_t::Constant)
 		{
-			if (rhs[0].type != term_t::Variable)
+			// can't unify two different constants
+			if (lhs_term != rhs_term)
 			{
 				return false;
 			}
 
-			if (rhs[0].op == operation_t::Negation)
-			{
-				lhs.negation();
-			}
+			continue;
+		}
 
-			if (!add_constraint(rhs[0], lhs, sub))
-			{
-				return false;
-			}
+		// constant can't be unified with function
+		return false;
+	}
+
+	return !is_cyclic(store, sub);
+}
+
+
+void instantiate(
+	const TermStore &store,
+	Binding root,
+	const Substitution &substitution,
+	std::pmr::vector<Term> &preorder
+)
+{
+	if (root.term == INVALID_TERM)
+	{
+		return;
+	}
+
+	preorder.reserve(preorder.size() + store.size(root.term));
+
+	std::pmr::vector<Binding> s(preorder.get_allocator().resource());
+	s.push_back(root);
+
+	while (!s.empty())
+	{
+		auto current = s.back();
+		s.pop_back();
 
+		auto term = view_term(store, current);
+
+		if (term.type == term_t::Function)
+		{
+			preorder.push_back(term);
+			s.push_back(view_right(store, current));
+			s.push_back(view_left(store, current));
 			continue;
 		}
 
-		// case 6: right term is function
-		if (rhs[0].type == term_t::Function)
+		if (term.type != term_t::Variable)
 		{
-			if (lhs[0].type != term_t::Variable)
-			{
-				return false;
-			}
-
-			if (lhs[0].op == operation_t::Negation)
-			{
-				rhs.negation();
-			}
-
-			if (!add_constraint(lhs[0], rhs, sub))
-			{
-				return false;
-			}
+			preorder.push_back(term);
+			continue;
+		}
 
+		const auto *value = bound(store, current, substitution);
+		if (value == nullptr)
+		{
+			term.value += current.offset;
+			preorder.push_back(term);
 			continue;
 		}
 
-		// something went wrong during unification?
-		// this point is basically unreachable
-		return false;
+		// substitution of !A is negated value of A
+		auto next = *value;
+		next.negated = next.negated != (term.op == operation_t::Negation);
+		s.push_back(next);
 	}
+}
 
-	std::vector<std::vector<value_t>> adjacent(v - 1);
-	for (const auto &[u, expr] : sub)
+
+void normalize(std::pmr::vector<Term> &preorder)
+{
+	value_t max_value = 0;
+	for (const auto &term : preorder)
 	{
-		for (const auto &w : expr.variables())
+		if (term.type == term_t::Variable)
 		{
-			adjacent[w - 1].push_back(u - 1);
+			max_value = std::max(max_value, term.value);
 		}
 	}
 
-	auto order = topological_sort(adjacent, v - 1);
-	for (auto &variable : order)
-	{
-		variable = variable + 1;
+	// leaves of preorder sequence are in the same order as in inorder one
+	std::pmr::vector<value_t> remapping(
+		static_cast<std::size_t>(max_value) + 1,
+		0,
+		preorder.get_allocator().resource()
+	);
 
-		if (!sub.contains(variable))
+	value_t new_value = 1;
+	for (auto &term : preorder)
+	{
+		if (term.type != term_t::Variable)
 		{
 			continue;
 		}
 
-		auto &expr = sub.at(variable);
-		if (expr[0].type != term_t::Function)
+		auto &value = remapping[term.value];
+		if (value == 0)
 		{
-			continue;
+			value = new_value++;
 		}
 
-		for (const auto &var : expr.variables())
+		term.value = value;
+	}
+}
+
+
+bool is_equal(TermStore &store, term_id left, term_id right)
+{
+	// few O(1) checks
+	if (left == INVALID_TERM || right == INVALID_TERM ||
+		store.size(left) != store.size(right))
+	{
+		return false;
+	}
+
+	if (store.term(left).op != store.term(right).op)
+	{
+		return false;
+	}
+
+	return store.equals(store.normalize(left), store.normalize(right));
+}
+
+
+bool matches(TermStore &store, term_id pattern, term_id instance, std::vector<term_id> &bindings)
+{
+	if (pattern == INVALID_TERM || instance == INVALID_TERM ||
+		store.size(pattern) > store.size(instance))
+	{
+		return false;
+	}
+
+	// only variables of pattern are bound, variables of instance are rigid
+	bindings.assign(static_cast<std::size_t>(std::max(store.max_value(pattern), 0)) + 1, INVALID_TERM);
+	std::vector<std::pair<term_id, term_id>> pending = {{pattern, instance}};
+
+	while (!pending.empty())
+	{
+		const auto [p, i] = pending.back();
+		pending.pop_back();
+
+		const auto term = store.term(p);
+		if (term.type == term_t::Variable)
 		{
-			if (!sub.contains(var))
-			{
-				continue;
-			}
+			// !A matches `i` if A is bound to negation of `i`
+			const auto value = term.op == operation_t::Negation ? store.negation(i) : i;
+			auto &binding = bindings[term.value];
 
-			auto replacement = sub.at(var);
-			while (replacement[0].type == term_t::Variable &&
-					sub.contains(replacement[0].value))
+			if (binding == INVALID_TERM)
 			{
-				bool should_negate = replacement[0].op == operation_t::Negation;
-				replacement = sub.at(replacement[0].value);
-				if (should_negate)
-				{
-					replacement.negation();
-				}
+				binding = value;
 			}
-
-			Term to_check(term_t::Variable, operation_t::Nop, var);
-			if (replacement.contains(to_check))
+			else if (binding != value)
 			{
 				return false;
 			}
 
-			expr.replace(var, replacement);
+			continue;
+		}
+
+		const auto other = store.term(i);
+		if (term.type != other.type || term.op != other.op || term.value != other.value)
+		{
+			return false;
+		}
+
+		if (term.type == term_t::Function)
+		{
+			pending.emplace_back(store.left(p), store.left(i));
+			pending.emplace_back(store.right(p), store.right(i));
 		}
 	}
 
-	substitution = std::move(sub);
 	return true;
 }
 
 
-bool is_equal(Expression left, Expression right)
+bool matches(TermStore &store, term_id pattern, term_id instance)
 {
-	// few O(1) checks
-	if (left.size() != right.size())
+	std::vector<term_id> bindings;
+	return matches(store, pattern, instance, bindings);
+}
+
+
+term_id substitute(TermStore &store, term_id id, const std::vector<term_id> &bindings, value_t offset)
+{
+	if (id == INVALID_TERM)
 	{
-		return false;
+		return INVALID_TERM;
 	}
 
-	if (left[0].op != right[0].op)
+	auto term = store.term(id);
+	if (term.type == term_t::Function)
 	{
-		return false;
+		const auto left = substitute(store, store.left(id), bindings, offset);
+		const auto right = substitute(store, store.right(id), bindings, offset);
+		return store.function(term.op, left, right);
 	}
 
-	left.normalize();
-	right.normalize();
+	if (term.type != term_t::Variable)
+	{
+		return id;
+	}
 
-	return left.equals(right);
+	const auto value = static_cast<std::size_t>(term.value);
+	if (value < bindings.size() && bindings[value] != INVALID_TERM)
+	{
+		return term.op == operation_t::Negation ? store.negation(bindings[value]) : bindings[value];
+	}
+
+	term.value += offset;
+	return store.leaf(term);
 }
@@ -1,15 +1,13 @@
 #ifndef HELPER_HPP
 #define HELPER_HPP
 
+#include <span>
+#include <vector>
+#include <utility>
 #include <unordered_map>
+#include <memory_resource>
 #include "ast.hpp"
-
-
-bool add_constraint(
-	Term term,
-	Expression substitution,
-	std::unordered_map<value_t, Expression> &sub
-);
+#include "term_store.hpp"
 
 
 /**
@@ -20,7 +18,7 @@ bool add_constraint(
  * @param right The right-hand side expression.
  * @param substitution A reference to a map where the resulting substitution will be stored.
  *
- * @note `right` is unified to `left`
+ * @note `right` is unified to `left`, values of substitution are fully instantiated
  *
  * @return Returns `true` if unification was successful, `false` otherwise.
  */
@@ -43,4 +41,132 @@ bool unification(
  */
 bool is_equal(Expression left, Expression right);
 
+
+/**
+ * @brief Value of a variable produced by unification over TermStore
+ *
+ * @note variables of `term` are shifted by `offset`,
+ * `negated` means that negation of `term` is used
+ */
+struct Binding
+{
+	term_id term;
+	value_t offset;
+	bool negated;
+};
+
+
+/**
+ * @brief triangular substitution indexed by shifted variable value
+ *
+ * @note unbound variables have INVALID_TERM binding, values may contain
+ * bound variables. Memory is taken from resource of caller (e.g. Arena),
+ * so failed attempt of unification doesn't touch the heap
+ */
+using Substitution = std::pmr::vector<Binding>;
+
+
+/**
+ * @brief Performs unification between two stored expressions,
+ * producing a substitution if possible.
+ *
+ * @param store The storage both expressions belong to.
+ * @param left The left-hand side expression.
+ * @param right The right-hand side expression.
+ * @param substitution A reference to a dense array where the resulting substitution will be stored.
+ *
+ * @note variables of `right` are shifted by `store.max_value(left)`
+ * to avoid intersections, substitution is indexed by shifted values.
+ * Store is not modified, so it's safe to call it concurrently.
+ * Scratch memory is taken from allocator of `substitution`.
+ * Occurs check is done once after all of the bindings are made.
+ *
+ * @return Returns `true` if unification was successful, `false` otherwise.
+ */
+bool unification(
+	const TermStore &store,
+	term_id left,
+	term_id right,
+	Substitution &substitution
+);
+
+
+/**
+ * @brief Simultaneous unification of several pairs of stored expressions,
+ * producing one substitution for all of them if possible.
+ *
+ * @param store The storage all expressions belong to.
+ * @param equations Pairs of expressions seen through bindings with their own shifts.
+ * @param variables The max shifted value of variable over all of the expressions.
+ * @param substitution A reference to a dense array where the resulting substitution will be stored.
+ *
+ * @note shifts are chosen by caller, so the same variable may be shared
+ * by several pairs. Variables of right sides are kept as in binary version.
+ *
+ * @return Returns `true` if unification was successful, `false` otherwise.
+ */
+bool unification(
+	const TermStore &store,
+	std::span<const std::pair<Binding, Binding>> equations,
+	value_t variables,
+	Substitution &substitution
+);
+
+
+/**
+ * @brief Applies substitution produced by unification to stored expression
+ *
+ * @param store The storage expression belongs to.
+ * @param root The expression to instantiate with shift of its variables.
+ * @param substitution The substitution to apply.
+ * @param preorder Preorder sequence of terms of instantiated expression is appended here.
+ *
+ * @note single pass, variables without substitution are kept shifted,
+ * scratch memory is taken from allocator of `preorder`
+ */
+void instantiate(
+	const TermStore &store,
+	Binding root,
+	const Substitution &substitution,
+	std::pmr::vector<Term> &preorder
+);
+
+
+/**
+ * @brief rename variables of preorder sequence in order of first occurrence
+ * @note same as Expression::normalize
+ */
+void normalize(std::pmr::vector<Term> &preorder);
+
+
+/**
+ * @brief Check if left and right stored expressions are the same
+ *
+ * @note unification of variables is allowed
+ */
+bool is_equal(TermStore &store, term_id left, term_id right);
+
+
+/**
+ * @brief one-way matching: is `instance` a substitution instance of `pattern`?
+ *
+ * @note only variables of `pattern` are substituted, variables of `instance`
+ * are treated as constants. Store is modified by negations of matched subtrees.
+ */
+bool matches(TermStore &store, term_id pattern, term_id instance);
+
+/**
+ * @brief one-way matching which keeps the substitution
+ * @note `bindings` is indexed by variable value of `pattern`,
+ * unbound variables have INVALID_TERM binding
+ */
+bool matches(TermStore &store, term_id pattern, term_id instance, std::vector<term_id> &bindings);
+
+
+/**
+ * @brief apply bindings of `matches` to stored expression
+ * @note unbound variables are shifted by `offset`
+ */
+term_id substitute(TermStore &store, term_id id, const std::vector<term_id> &bindings, value_t offset);
+
 #endif // HELPER_HPP
@@ -0,0 +1,318 @@
+#include <algorithm>
+#include <stdexcept>
+#include "rule_schema.hpp"
+#include "helper.hpp"
+#include "arena.hpp"
+#include "tautology.hpp"
+
+
+namespace
+{
+
+constexpr const std::size_t OPERATIONS = static_cast<std::size_t>(operation_t::Equivalent) + 1;
+
+
+// formula of schema without spaces, empty if it isn't well-formed
+std::string formula_text(std::string_view text)
+{
+	std::string result;
+	std::int32_t depth = 0;
+
+	for (const auto c : text)
+	{
+		if (c == ' ' || c == '\t')
+		{
+			continue;
+		}
+
+		if (c == '(' || c == ')')
+		{
+			depth += c == '(' ? 1 : -1;
+			if (depth < 0)
+			{
+				return {};
+			}
+		}
+		else if (!(c >= 'a' && c <= 'z') && std::string_view("!>|*+=").find(c) == std::string_view::npos)
+		{
+			return {};
+		}
+
+		result += c;
+	}
+
+	return depth == 0 ? result : std::string();
+}
+
+
+StoredRule compile(TermStore &store, const Rule &rule)
+{
+	StoredRule stored{rule.name, {}, store.intern(rule.conclusion), rule.conclusion.max_value()};
+
+	for (const auto &premise : rule.premises)
+	{
+		stored.premises.push_back(store.intern(premise));
+		stored.variables = std::max(stored.variables, premise.max_value());
+	}
+
+	return stored;
+}
+
+
+// premises without fact are skipped, k-th fact is shifted past the previous ones
+bool unify(
+	const TermStore &store,
+	const StoredRule &rule,
+	std::span<const term_id> facts,
+	Substitution &sub
+)
+{
+	if (facts.size() != rule.premises.size())
+	{
+		return false;
+	}
+
+	std::pmr::vector<std::pair<Binding, Binding>> equations(sub.get_allocator().resource());
+	value_t offset = rule.variables;
+
+	for (std::size_t k = 0; k < facts.size(); ++k)
+	{
+		if (facts[k] == INVALID_TERM)
+		{
+			continue;
+		}
+
+		equations.emplace_back(Binding{rule.premises[k], 0, false}, Binding{facts[k], offset, false});
+		offset += store.max_value(facts[k]);
+	}
+
+	if (equations.empty())
+	{
+		sub.clear();
+		return true;
+	}
+
+	return unification(store, equations, offset, sub);
+}
+
+}
+
+
+Rule compile_rule(std::string name, std::string_view schema)
+{
+	const auto turnstile = schema.find("|-");
+	if (name.empty() || turnstile == std::string_view::npos)
+	{
+		throw std::invalid_argument("[-] error: malformed rule schema " + std::string(schema));
+	}
+
+	std::vector<std::string> texts;
+	for (auto premises = schema.substr(0, turnstile); !premises.empty();)
+	{
+		const auto comma = std::min(premises.find(','), premises.size());
+		texts.push_back(formula_text(premises.substr(0, comma)));
+		premises.remove_prefix(std::min(comma + 1, premises.size()));
+	}
+
+	const auto conclusion = formula_text(schema.substr(turnstile + 2));
+
+	if (texts.empty() || conclusion.empty() || std::ranges::any_of(texts, &std::string::empty))
+	{
+		throw std::invalid_argument("[-] error: malformed rule schema " + std::string(schema));
+	}
+
+	Rule rule{std::move(name), {}, {}};
+
+	// p1 > (... > (pn > c)) is a tautology iff rule is sound
+	auto implication = "(" + conclusion + ")";
+	for (auto it = texts.rbegin(); it != texts.rend(); ++it)
+	{
+		implication = "(" + *it + ")>" + implication;
+		implication = "(" + implication + ")";
+	}
+
+	try
+	{
+		for (const auto &text : texts)
+		{
+			rule.premises.emplace_back(text);
+			rule.premises.back().standardize();
+		}
+
+		rule.conclusion = Expression(conclusion);
+		rule.conclusion.standardize();
+
+		if (!is_tautology(Expression(implication)))
+		{
+			throw std::invalid_argument("[-] error: rule " + rule.name + " is unsound: " + std::string(schema));
+		}
+	}
+	catch (const std::runtime_error &)
+	{
+		throw std::invalid_argument("[-] error: malformed rule schema " + std::string(schema));
+	}
+
+	return rule;
+}
+
+
+const std::vector<Rule> &standard_rules()
+{
+	static const std::vector<Rule> rules = {
+		compile_rule("mp", "a, a>b |- b"),
+		compile_rule("mt", "a>b, !b |- !a"),
+		compile_rule("ds", "!a, a|b |- b"),
+		compile_rule("ss", "a, a+b |- !b"),
+		compile_rule("cr", "a>b, a>!b |- !a"),
+		compile_rule("hs", "a>b, b>c |- a>c"),
+		compile_rule("scd", "a>c, b>c, a|b |- c"),
+		compile_rule("sdd", "a>c, a>b, !b|!c |- !a"),
+		compile_rule("ccd", "a>c, b>d, a|b |- c|d"),
+		compile_rule("cdd", "a>c, b>d, !c|!d |- !a|!b")
+	};
+
+	return rules;
+}
+
+
+const Rule *find_rule(std::string_view name)
+{
+	const auto &rules = standard_rules();
+	const auto it = std::ranges::find(rules, name, &Rule::name);
+	return it == rules.end() ? nullptr : &*it;
+}
+
+
+bool apply(
+	const TermStore &store,
+	const StoredRule &rule,
+	std::span<const term_id> facts,
+	std::pmr::vector<Term> &result
+)
+{
+	if (std::ranges::find(facts, INVALID_TERM) != facts.end())
+	{
+		return false;
+	}
+
+	Substitution substitution(result.get_allocator().resource());
+	if (!unify(store, rule, facts, substitution))
+	{
+		return false;
+	}
+
+	result.clear();
+	instantiate(store, {rule.conclusion, 0, false}, substitution, result);
+	normalize(result);
+
+	return true;
+}
+
+
+bool instantiate_premise(
+	const TermStore &store,
+	const StoredRule &rule,
+	std::span<const term_id> facts,
+	std::size_t position,
+	std::pmr::vector<Term> &result
+)
+{
+	Substitution substitution(result.get_allocator().resource());
+	if (position >= rule.premises.size() || !unify(store, rule, facts, substitution))
+	{
+		return false;
+	}
+
+	result.clear();
+	instantiate(store, {rule.premises[position], 0, false}, substitution, result);
+
+	return true;
+}
+
+
+Expression apply(const Rule &rule, std::span<const Expression> facts)
+{
+	if (std::ranges::any_of(facts, &Expression::empty))
+	{
+		return {};
+	}
+
+	TermStore store;
+	Arena arena(1 << 12);
+
+	const auto stored = compile(store, rule);
+
+	std::vector<term_id> ids;
+	for (auto fact : facts)
+	{
+		fact.standardize();
+		ids.push_back(store.intern(fact));
+	}
+
+	std::pmr::vector<Term> result(&arena);
+	if (!apply(store, stored, ids, result))
+	{
+		return {};
+	}
+
+	return Expression{result};
+}
+
+
+RuleSet::RuleSet()
+	: rules_()
+	, by_operation_(OPERATIONS)
+	, any_()
+{}
+
+
+RuleSet::RuleSet(TermStore &store, const std::vector<Rule> &rules)
+	: RuleSet()
+{
+	for (const auto &rule : rules)
+	{
+		const auto index = static_cast<std::uint32_t>(rules_.size());
+		rules_.push_back(compile(store, rule));
+
+		for (std::uint32_t k = 0; k < rules_.back().premises.size(); ++k)
+		{
+			const auto &term = store.term(rules_.back().premises[k]);
+
+			if (term.type == term_t::Function)
+			{
+				by_operation_[static_cast<std::size_t>(term.op)].emplace_back(index, k);
+			}
+			else
+			{
+				any_.emplace_back(index, k);
+			}
+		}
+	}
+}
+
+
+const StoredRule *RuleSet::find(std::string_view name) const
+{
+	const auto it = std::ranges::find(rules_, name, &StoredRule::name);
+	return it == rules_.end() ? nullptr : &*it;
+}
+
+
+void RuleSet::premises_of(
+	const TermStore &store,
+	term_id fact,
+	std::vector<std::pair<std::uint32_t, std::uint32_t>> &result
+) const
+{
+	const auto first = result.size();
+	const auto &term = store.term(fact);
+
+	if (term.type == term_t::Function)
+	{
+		const auto &premises = by_operation_[static_cast<std::size_t>(term.op)];
+		result.insert(result.end(), premises.begin(), premises.end());
+	}
+
+	result.insert(result.end(), any_.begin(), any_.end());
+	std::sort(result.begin() + first, result.end());
+}
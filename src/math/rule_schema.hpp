@@ -0,0 +1,127 @@
+#ifndef RULE_SCHEMA_HPP
+#define RULE_SCHEMA_HPP
+
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+#include <memory_resource>
+#include "ast.hpp"
+#include "term_store.hpp"
+
+
+/**
+ * @brief inference rule given by schema `p1, ..., pn |- c`
+ *
+ * @note premises and conclusion are standardized, their variables are shared
+ */
+struct Rule
+{
+	std::string name;
+	std::vector<Expression> premises;
+	Expression conclusion;
+};
+
+
+/**
+ * @brief compile schema such as `a, a>b |- b` or `a>b, b>c |- a>c`
+ * @note throws std::invalid_argument if schema is malformed or unsound,
+ * i.e. p1 > (... > (pn > c)) isn't a tautology
+ */
+Rule compile_rule(std::string name, std::string_view schema);
+
+
+/**
+ * @brief rules of rules.hpp: mp, mt, ds, ss, cr, hs, scd, sdd, ccd, cdd
+ */
+const std::vector<Rule> &standard_rules();
+
+// standard rule by name, nullptr if there is none
+const Rule *find_rule(std::string_view name);
+
+
+/**
+ * @brief rule with premises and conclusion interned in store
+ *
+ * @note variables of schema take values 1..variables, fact of k-th premise
+ * is shifted past schema and facts of previous premises
+ */
+struct StoredRule
+{
+	std::string name;
+	std::vector<term_id> premises;
+	term_id conclusion;
+	value_t variables;
+};
+
+
+/**
+ * @brief conclusion of rule whose premises are unified with `facts` at once
+ *
+ * @note `result` is replaced with normalized preorder sequence of terms,
+ * scratch memory is taken from its allocator. Store isn't modified, so
+ * it's safe to call it concurrently. Returns `false` if rule can't be applied.
+ */
+bool apply(
+	const TermStore &store,
+	const StoredRule &rule,
+	std::span<const term_id> facts,
+	std::pmr::vector<Term> &result
+);
+
+
+/**
+ * @brief instance of `position`-th premise once the other ones are unified with `facts`
+ * @note premises without fact have INVALID_TERM in `facts`, `result` is replaced
+ * with preorder sequence of terms, it's a query of partners of the premise
+ */
+bool instantiate_premise(
+	const TermStore &store,
+	const StoredRule &rule,
+	std::span<const term_id> facts,
+	std::size_t position,
+	std::pmr::vector<Term> &result
+);
+
+
+/**
+ * @brief rule applied to expressions, premises are standardized before
+ * @note empty expression is returned if rule can't be applied
+ */
+Expression apply(const Rule &rule, std::span<const Expression> facts);
+
+
+/**
+ * @brief rules compiled into one store and indexed by shape of premises
+ *
+ * @note premise which is a variable may be filled by any fact,
+ * other ones only by facts with the same top operation
+ */
+class RuleSet
+{
+	std::vector<StoredRule> rules_;
+
+	// (rule, premise) pairs by top operation of premise
+	std::vector<std::vector<std::pair<std::uint32_t, std::uint32_t>>> by_operation_;
+	std::vector<std::pair<std::uint32_t, std::uint32_t>> any_;
+public:
+	RuleSet();
+	RuleSet(TermStore &store, const std::vector<Rule> &rules);
+
+	inline std::size_t size() const noexcept { return rules_.size(); }
+	inline bool empty() const noexcept { return rules_.empty(); }
+	inline const StoredRule &operator[](std::size_t i) const noexcept { return rules_[i]; }
+
+	// rule by name, nullptr if there is none
+	const StoredRule *find(std::string_view name) const;
+
+	// (rule, premise) pairs which `fact` may fill are appended to `result`
+	void premises_of(
+		const TermStore &store,
+		term_id fact,
+		std::vector<std::pair<std::uint32_t, std::uint32_t>> &result
+	) const;
+};
+
+#endif // RULE_SCHEMA_HPP
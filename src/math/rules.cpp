@@ -3,8 +3,10 @@
 #include <unordered_map>
 #include <string>
 #include "rules.hpp"
+#include "rule_schema.hpp"
 #include "helper.hpp"
 #include "ast.hpp"
+#include "arena.hpp"
 
 
 Expression modus_ponens(const Expression &lhs, const Expression &rhs)
@@ -60,5 +62,123 @@ Expression modus_ponens(const Expression &lhs, const Expression &rhs)
 	result = result.subtree_copy(result.subtree(0).right());
 	result.normalize();
 
-        return result;
+	return result;
+}
+
+
+Expression modus_ponens(const TermStore &store, term_id lhs, term_id rhs)
+{
+	Arena arena(1 << 12);
+	std::pmr::vector<Term> result(&arena);
+
+	if (!modus_ponens(store, lhs, rhs, result))
+	{
+		return {};
+	}
+
+	return Expression{result};
+}
+
+
+bool modus_ponens(
+	const TermStore &store,
+	term_id lhs,
+	term_id rhs,
+	std::pmr::vector<Term> &result
+)
+{
+	if (lhs == INVALID_TERM || rhs == INVALID_TERM)
+	{
+		return false;
+	}
+
+	if (store.term(rhs).op != operation_t::Implication)
+	{
+		return false;
+	}
+
+	// try to apply unification
+	Substitution substitution(result.get_allocator().resource());
+	if (!unification(store, lhs, store.left(rhs), substitution))
+	{
+		return false;
+	}
+
+	// unification succeeded, variables of `rhs` are shifted by max of `lhs`
+	result.clear();
+	instantiate(
+		store,
+		{store.right(rhs), store.max_value(lhs), false},
+		substitution,
+		result
+	);
+
+	normalize(result);
+
+	return true;
+}
+
+
+namespace
+{
+
+Expression apply_rule(std::string_view name, std::initializer_list<Expression> premises)
+{
+	return apply(*find_rule(name), std::span<const Expression>(premises.begin(), premises.size()));
+}
+
+}
+
+
+Expression modus_tollens(const Expression &a, const Expression &b)
+{
+	return apply_rule("mt", {a, b});
+}
+
+
+Expression disjunctive_syllogism(const Expression &a, const Expression &b)
+{
+	return apply_rule("ds", {a, b});
+}
+
+
+Expression separating_syllogism(const Expression &a, const Expression &b)
+{
+	return apply_rule("ss", {a, b});
+}
+
+
+Expression contradiction_rule(const Expression &a, const Expression &b)
+{
+	return apply_rule("cr", {a, b});
+}
+
+
+Expression hypothetical_syllogism(const Expression &a, const Expression &b)
+{
+	return apply_rule("hs", {a, b});
+}
+
+
+Expression simple_constructive_dilemma(const Expression &a, const Expression &b, const Expression &c)
+{
+	return apply_rule("scd", {a, b, c});
+}
+
+
+Expression simple_destructive_dilemma(const Expression &a, const Expression &b, const Expression &c)
+{
+	return apply_rule("sdd", {a, b, c});
+}
+
+
+Expression complex_constructive_dilemma(const Expression &a, const Expression &b, const Expression &c)
+{
+	return apply_rule("ccd", {a, b, c});
+}
+
+
+Expression complex_destructive_dilemma(const Expression &a, const Expression &b, const Expression &c)
+{
+	return apply_rule("cdd", {a, b, c});
 }
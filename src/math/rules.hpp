@@ -1,15 +1,34 @@
 #ifndef RULES_HPP
 #define RULES_HPP
 
+#include <vector>
+#include <memory_resource>
 #include "ast.hpp"
+#include "term_store.hpp"
 
 
+// rules other than stored modus ponens are compiled from schemas of rule_schema.hpp,
+// arguments are premises in order of schema
+
 // 2 variables
 /**
  * @brief a, a > b ⊢ b
  */
 Expression modus_ponens(const Expression &a, const Expression &b);
 
+/**
+ * @brief a, a > b ⊢ b
+ * @note stored version, result is normalized and not stored
+ */
+Expression modus_ponens(const TermStore &store, term_id a, term_id b);
+
+/**
+ * @brief a, a > b ⊢ b
+ * @note stored version, `result` is replaced with normalized preorder sequence of terms,
+ * scratch memory is taken from its allocator. Returns `false` if rule can't be applied.
+ */
+bool modus_ponens(const TermStore &store, term_id a, term_id b, std::pmr::vector<Term> &result);
+
 /**
  * @brief a > b, !b ⊢ !a
  */
@@ -26,7 +45,7 @@ Expression disjunctive_syllogism(const Expression &a, const Expression &b);
 Expression separating_syllogism(const Expression &a, const Expression &b);
 
 /**
- * @brief a, a xor b ⊢ !b
+ * @brief a > b, a > !b ⊢ !a
  */
 Expression contradiction_rule(const Expression &a, const Expression &b);
 
@@ -35,7 +54,7 @@ Expression contradiction_rule(const Expression &a, const Expression &b);
 /**
  * @brief a > b, b > c ⊢ a > c
  */
-Expression hypothetical_syllogism(const Expression &a, const Expression &b, const Expression &c);
+Expression hypothetical_syllogism(const Expression &a, const Expression &b);
 
 /**
  * @brief a > c, b > c, a | b ⊢ c
@@ -51,12 +70,12 @@ Expression simple_destructive_dilemma(const Expression &a, const Expression &b,
 /**
  * @brief a > c, b > d, a | b ⊢ c | d
  */
-Expression complex_constructive_dilemma(const Expression &a, const Expression &b, const Expression &c, const Expression &d);
+Expression complex_constructive_dilemma(const Expression &a, const Expression &b, const Expression &c);
 
 /**
  * @brief a > c, b > d, !c | !d ⊢ !a | !b
  */
-Expression complex_destructive_dilemma(const Expression &a, const Expression &b, const Expression &c, const Expression &d);
+Expression complex_destructive_dilemma(const Expression &a, const Expression &b, const Expression &c);
 
 
 #endif // RULES_HPP
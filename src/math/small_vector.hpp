@@ -0,0 +1,155 @@
+#ifndef SMALL_VECTOR_HPP
+#define SMALL_VECTOR_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <algorithm>
+#include <type_traits>
+
+
+/**
+ * @brief vector of trivially copyable values with inline storage for `N` of them
+ *
+ * @note heap is used only when size exceeds `N`
+ */
+template <typename T, std::size_t N>
+class SmallVector
+{
+	static_assert(std::is_trivially_copyable_v<T>);
+	static_assert(N > 0);
+
+	T inline_[N];
+	std::unique_ptr<T[]> heap_;
+	T *data_;
+	std::size_t size_;
+	std::size_t capacity_;
+
+	inline bool is_inline() const noexcept { return data_ == inline_; }
+
+public:
+	SmallVector() noexcept
+		: data_(inline_)
+		, size_(0)
+		, capacity_(N)
+	{}
+
+	SmallVector(const SmallVector &other)
+		: SmallVector()
+	{
+		assign(other.begin(), other.end());
+	}
+
+	SmallVector(SmallVector &&other) noexcept
+		: SmallVector()
+	{
+		*this = std::move(other);
+	}
+
+	SmallVector &operator=(const SmallVector &other)
+	{
+		if (this != &other)
+		{
+			assign(other.begin(), other.end());
+		}
+
+		return *this;
+	}
+
+	SmallVector &operator=(SmallVector &&other) noexcept
+	{
+		if (this == &other)
+		{
+			return *this;
+		}
+
+		if (other.is_inline())
+		{
+			// inline values can't be stolen
+			std::memcpy(inline_, other.inline_, other.size_ * sizeof(T));
+			heap_.reset();
+			data_ = inline_;
+			capacity_ = N;
+		}
+		else
+		{
+			heap_ = std::move(other.heap_);
+			data_ = heap_.get();
+			capacity_ = other.capacity_;
+
+			other.data_ = other.inline_;
+			other.capacity_ = N;
+		}
+
+		size_ = other.size_;
+		other.size_ = 0;
+		return *this;
+	}
+
+	inline T *begin() noexcept { return data_; }
+	inline T *end() noexcept { return data_ + size_; }
+	inline const T *begin() const noexcept { return data_; }
+	inline const T *end() const noexcept { return data_ + size_; }
+
+	inline T &operator[](std::size_t idx) noexcept { return data_[idx]; }
+	inline const T &operator[](std::size_t idx) const noexcept { return data_[idx]; }
+	inline T &back() noexcept { return data_[size_ - 1]; }
+	inline void pop_back() noexcept { --size_; }
+
+	inline std::size_t size() const noexcept { return size_; }
+	inline bool empty() const noexcept { return size_ == 0; }
+	inline void clear() noexcept { size_ = 0; }
+
+	void reserve(std::size_t capacity)
+	{
+		if (capacity <= capacity_)
+		{
+			return;
+		}
+
+		auto heap = std::make_unique_for_overwrite<T[]>(capacity);
+		std::memcpy(heap.get(), data_, size_ * sizeof(T));
+
+		heap_ = std::move(heap);
+		data_ = heap_.get();
+		capacity_ = capacity;
+	}
+
+	void resize(std::size_t size, const T &value = T{})
+	{
+		reserve(size);
+		std::fill(data_ + std::min(size, size_), data_ + size, value);
+		size_ = size;
+	}
+
+	void push_back(const T &value)
+	{
+		if (size_ == capacity_)
+		{
+			reserve(2 * capacity_);
+		}
+
+		data_[size_++] = value;
+	}
+
+	// append values of [first, last)
+	void append(const T *first, const T *last)
+	{
+		const auto count = static_cast<std::size_t>(last - first);
+		if (size_ + count > capacity_)
+		{
+			reserve(std::max(2 * capacity_, size_ + count));
+		}
+
+		std::memcpy(data_ + size_, first, count * sizeof(T));
+		size_ += count;
+	}
+
+	void assign(const T *first, const T *last)
+	{
+		clear();
+		append(first, last);
+	}
+};
+
+#endif // SMALL_VECTOR_HPP
@@ -0,0 +1,377 @@
+#include <bit>
+#include <map>
+#include <array>
+#include <tuple>
+#include <algorithm>
+#include <stdexcept>
+#include "tautology.hpp"
+
+
+// truth table kernel is cloned for AVX2, the best clone is chosen at load time
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__)
+#define AVX2_CLONES __attribute__((target_clones("avx2", "default")))
+#else
+#define AVX2_CLONES
+#endif
+
+
+namespace
+{
+
+constexpr const std::size_t TABLE_ATOMS = 14;
+
+// 256 assignments are evaluated at once
+constexpr const std::size_t BLOCK_WORDS = 4;
+using block_t = std::array<std::uint64_t, BLOCK_WORDS>;
+
+// bit i of mask k is set iff bit k of i is set
+constexpr const std::uint64_t WORD_MASKS[] = {
+	0xAAAAAAAAAAAAAAAAull,
+	0xCCCCCCCCCCCCCCCCull,
+	0xF0F0F0F0F0F0F0F0ull,
+	0xFF00FF00FF00FF00ull,
+	0xFFFF0000FFFF0000ull,
+	0xFFFFFFFF00000000ull
+};
+
+// truth value of partial assignment
+constexpr const std::int8_t UNKNOWN = 2;
+
+
+// node of expression, leaves have non-negative atom
+struct Instruction
+{
+	operation_t op;
+	std::int32_t atom;
+	bool negated;
+};
+
+
+/**
+ * @brief expression in reverse preorder, so both children of function
+ * are on top of stack when it's evaluated, left one is the topmost
+ *
+ * @note atoms before `splits` occur most often, they are split on,
+ * the rest are evaluated over truth table
+ */
+struct Program
+{
+	std::vector<Instruction> instructions;
+	std::vector<std::pair<term_t, value_t>> atoms;
+	std::size_t splits = 0;
+	std::size_t depth = 0;
+};
+
+
+struct Scratch
+{
+	std::vector<std::int8_t> truth;
+	std::vector<std::int8_t> values;
+	std::vector<block_t> atoms;
+	std::vector<block_t> stack;
+};
+
+
+Program compile(const Expression &expression)
+{
+	Program program;
+	std::map<std::pair<term_t, value_t>, std::int32_t> index;
+	std::vector<std::size_t> occurrences;
+	std::size_t top = 0;
+
+	for (auto idx = expression.size(); idx-- > 0;)
+	{
+		const auto term = expression[idx];
+
+		if (term.type == term_t::Function)
+		{
+			if (term.op < operation_t::Implication || term.op > operation_t::Equivalent || top < 2)
+			{
+				throw std::invalid_argument("[-] error: malformed expression " + expression.to_string());
+			}
+
+			program.instructions.push_back({term.op, -1, false});
+			--top;
+			continue;
+		}
+
+		const auto [it, inserted] = index.try_emplace({term.type, term.value}, index.size());
+		if (inserted)
+		{
+			program.atoms.push_back(it->first);
+			occurrences.push_back(0);
+		}
+
+		++occurrences[it->second];
+		program.instructions.push_back({operation_t::Nop, it->second, term.op == operation_t::Negation});
+		program.depth = std::max(program.depth, ++top);
+	}
+
+	if (top != 1)
+	{
+		throw std::invalid_argument("[-] error: malformed expression " + expression.to_string());
+	}
+
+	// the most frequent atoms decide expression after the fewest splits
+	std::vector<std::int32_t> order(program.atoms.size());
+	for (std::size_t i = 0; i < order.size(); ++i)
+	{
+		order[i] = static_cast<std::int32_t>(i);
+	}
+
+	std::ranges::stable_sort(order, [&] (auto lhs, auto rhs) {
+		return occurrences[lhs] > occurrences[rhs];
+	});
+
+	std::vector<std::int32_t> remapping(order.size());
+	std::vector<std::pair<term_t, value_t>> atoms;
+	for (std::size_t i = 0; i < order.size(); ++i)
+	{
+		remapping[order[i]] = static_cast<std::int32_t>(i);
+		atoms.push_back(program.atoms[order[i]]);
+	}
+
+	for (auto &instruction : program.instructions)
+	{
+		if (instruction.atom >= 0)
+		{
+			instruction.atom = remapping[instruction.atom];
+		}
+	}
+
+	program.atoms = std::move(atoms);
+	program.splits = program.atoms.size() - std::min(program.atoms.size(), TABLE_ATOMS);
+	return program;
+}
+
+
+// truth value under partial assignment of atoms
+std::int8_t decide(const Program &program, const std::vector<std::int8_t> &truth, std::vector<std::int8_t> &stack)
+{
+	stack.clear();
+
+	for (const auto &instruction : program.instructions)
+	{
+		if (instruction.atom >= 0)
+		{
+			const auto value = truth[instruction.atom];
+			stack.push_back(value == UNKNOWN || !instruction.negated ? value : 1 - value);
+			continue;
+		}
+
+		const auto l = stack.back();
+		stack.pop_back();
+		const auto r = stack.back();
+		auto &result = stack.back();
+
+		switch (instruction.op)
+		{
+		case operation_t::Implication:
+			result = l == 0 || r == 1 ? 1 : (l == 1 && r == 0 ? 0 : UNKNOWN);
+			break;
+		case operation_t::Disjunction:
+			result = l == 1 || r == 1 ? 1 : (l == 0 && r == 0 ? 0 : UNKNOWN);
+			break;
+		case operation_t::Conjunction:
+			result = l == 0 || r == 0 ? 0 : (l == 1 && r == 1 ? 1 : UNKNOWN);
+			break;
+		case operation_t::Xor:
+			result = l == UNKNOWN || r == UNKNOWN ? UNKNOWN : l ^ r;
+			break;
+		default:
+			result = l == UNKNOWN || r == UNKNOWN ? UNKNOWN : 1 - (l ^ r);
+			break;
+		}
+	}
+
+	return stack.back();
+}
+
+
+// 256 assignments of expression, i-th bit of result is its value under i-th assignment
+AVX2_CLONES
+block_t evaluate(const Program &program, const block_t *atoms, block_t *stack)
+{
+	std::size_t top = 0;
+
+	for (const auto &instruction : program.instructions)
+	{
+		if (instruction.atom >= 0)
+		{
+			const auto &atom = atoms[instruction.atom];
+			const std::uint64_t flip = instruction.negated ? ~0ull : 0;
+
+			for (std::size_t i = 0; i < BLOCK_WORDS; ++i)
+			{
+				stack[top][i] = atom[i] ^ flip;
+			}
+
+			++top;
+			continue;
+		}
+
+		// copy of left operand doesn't alias result, so loops are vectorized
+		const auto l = stack[top - 1];
+		auto &r = stack[top - 2];
+		--top;
+
+		switch (instruction.op)
+		{
+		case operation_t::Implication:
+			for (std::size_t i = 0; i < BLOCK_WORDS; ++i) r[i] = ~l[i] | r[i];
+			break;
+		case operation_t::Disjunction:
+			for (std::size_t i = 0; i < BLOCK_WORDS; ++i) r[i] = l[i] | r[i];
+			break;
+		case operation_t::Conjunction:
+			for (std::size_t i = 0; i < BLOCK_WORDS; ++i) r[i] = l[i] & r[i];
+			break;
+		case operation_t::Xor:
+			for (std::size_t i = 0; i < BLOCK_WORDS; ++i) r[i] = l[i] ^ r[i];
+			break;
+		default:
+			for (std::size_t i = 0; i < BLOCK_WORDS; ++i) r[i] = ~(l[i] ^ r[i]);
+			break;
+		}
+	}
+
+	return stack[0];
+}
+
+
+// assignment of table atoms which falsifies expression, split atoms are fixed
+bool falsify_table(const Program &program, Scratch &scratch)
+{
+	const auto first = program.splits;
+	const auto table = program.atoms.size() - first;
+	const std::uint64_t words = table > 6 ? 1ull << (table - 6) : 1;
+
+	for (std::size_t k = 0; k < first; ++k)
+	{
+		scratch.atoms[k].fill(scratch.truth[k] == 1 ? ~0ull : 0);
+	}
+
+	// words over the table repeat assignments of the first ones
+	for (std::uint64_t base = 0; base < words; base += BLOCK_WORDS)
+	{
+		for (std::size_t k = 0; k < table; ++k)
+		{
+			for (std::size_t i = 0; i < BLOCK_WORDS; ++i)
+			{
+				scratch.atoms[first + k][i] = k < 6 ?
+					WORD_MASKS[k] :
+					(((base + i) >> (k - 6)) & 1 ? ~0ull : 0);
+			}
+		}
+
+		const auto result = evaluate(program, scratch.atoms.data(), scratch.stack.data());
+
+		for (std::size_t i = 0; i < BLOCK_WORDS; ++i)
+		{
+			if (~result[i] == 0)
+			{
+				continue;
+			}
+
+			const auto assignment = ((base + i) << 6) | std::countr_zero(~result[i]);
+			for (std::size_t k = 0; k < table; ++k)
+			{
+				scratch.truth[first + k] = static_cast<std::int8_t>((assignment >> k) & 1);
+			}
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+// split on atoms until partial assignment decides expression or truth table is small enough
+bool falsify(const Program &program, std::size_t next, Scratch &scratch)
+{
+	const auto value = decide(program, scratch.truth, scratch.values);
+
+	if (value == 1)
+	{
+		return false;
+	}
+
+	if (value == 0)
+	{
+		std::ranges::replace(scratch.truth, UNKNOWN, std::int8_t{0});
+		return true;
+	}
+
+	if (next == program.splits)
+	{
+		return falsify_table(program, scratch);
+	}
+
+	for (const std::int8_t truth : {0, 1})
+	{
+		scratch.truth[next] = truth;
+		if (falsify(program, next + 1, scratch))
+		{
+			return true;
+		}
+	}
+
+	scratch.truth[next] = UNKNOWN;
+	return false;
+}
+
+}
+
+
+std::optional<std::vector<Assignment>> counterexample(const Expression &expression)
+{
+	if (expression.empty())
+	{
+		throw std::invalid_argument("[-] error: empty expression");
+	}
+
+	const auto program = compile(expression);
+
+	Scratch scratch;
+	scratch.truth.assign(program.atoms.size(), UNKNOWN);
+	scratch.atoms.resize(program.atoms.size());
+	scratch.stack.resize(program.depth);
+
+	if (!falsify(program, 0, scratch))
+	{
+		return std::nullopt;
+	}
+
+	std::vector<Assignment> assignment;
+	for (std::size_t i = 0; i < program.atoms.size(); ++i)
+	{
+		const auto [type, value] = program.atoms[i];
+		assignment.push_back({type, value, scratch.truth[i] == 1});
+	}
+
+	std::ranges::sort(assignment, [] (const auto &lhs, const auto &rhs) {
+		return std::tie(lhs.type, lhs.value) < std::tie(rhs.type, rhs.value);
+	});
+
+	return assignment;
+}
+
+
+std::string to_string(const std::vector<Assignment> &assignment)
+{
+	std::string result;
+
+	for (const auto &atom : assignment)
+	{
+		if (!result.empty())
+		{
+			result += ", ";
+		}
+
+		result += Term(atom.type, operation_t::Nop, atom.value).to_string();
+		result += atom.truth ? " = 1" : " = 0";
+	}
+
+	return result;
+}
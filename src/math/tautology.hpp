@@ -0,0 +1,41 @@
+#ifndef TAUTOLOGY_HPP
+#define TAUTOLOGY_HPP
+
+#include <optional>
+#include <string>
+#include <vector>
+#include "ast.hpp"
+
+
+/**
+ * @brief truth value of variable or constant
+ */
+struct Assignment
+{
+	term_t type;
+	value_t value;
+	bool truth;
+};
+
+
+/**
+ * @brief assignment of every variable and constant of expression under
+ * which it's false, std::nullopt if expression is a tautology
+ *
+ * @note up to 14 atoms are evaluated over whole truth table, 64 assignments
+ * per word; atoms over it are split on while partial assignment doesn't
+ * decide expression
+ */
+std::optional<std::vector<Assignment>> counterexample(const Expression &expression);
+
+
+inline bool is_tautology(const Expression &expression)
+{
+	return !counterexample(expression).has_value();
+}
+
+
+// a = 1, b = 0
+std::string to_string(const std::vector<Assignment> &assignment);
+
+#endif // TAUTOLOGY_HPP
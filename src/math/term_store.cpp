@@ -0,0 +1,541 @@
+#include <algorithm>
+#include "term_store.hpp"
+
+
+std::size_t TermStore::KeyHash::operator()(const Key &key) const noexcept
+{
+	// children are already unique, so their ids are hashed instead of subtrees
+	return static_cast<std::size_t>(node_hash(
+		tag_type(key.tag),
+		tag_op(key.tag),
+		key.value,
+		key.left,
+		key.right
+	));
+}
+
+
+TermStore::Key TermStore::key(Term term, term_id left, term_id right) noexcept
+{
+	return {left, right, term.value, pack_tag(term.type, term.op)};
+}
+
+
+TermStore::TermStore()
+{
+	entries_.reserve(1 << 12);
+	negations_.reserve(1 << 12);
+	table_.reserve(1 << 12);
+}
+
+
+term_id TermStore::insert(Term term, term_id left, term_id right)
+{
+	const auto k = key(term, left, right);
+
+	if (auto it = table_.find(k); it != table_.end())
+	{
+		return it->second;
+	}
+
+	Entry entry{0, left, right, 1, 0, term.value, k.tag};
+	std::uint64_t left_hash = 0;
+	std::uint64_t right_hash = 0;
+
+	if (term.type == term_t::Variable)
+	{
+		entry.max_value = term.value;
+	}
+
+	if (left != INVALID_TERM)
+	{
+		entry.size += entries_[left].size;
+		entry.max_value = std::max(entry.max_value, entries_[left].max_value);
+		left_hash = entries_[left].hash;
+	}
+
+	if (right != INVALID_TERM)
+	{
+		entry.size += entries_[right].size;
+		entry.max_value = std::max(entry.max_value, entries_[right].max_value);
+		right_hash = entries_[right].hash;
+	}
+
+	entry.hash = node_hash(term.type, term.op, term.value, left_hash, right_hash);
+
+	const auto id = static_cast<term_id>(entries_.size());
+	entries_.push_back(entry);
+	negations_.push_back(INVALID_TERM);
+	table_.emplace(k, id);
+	return id;
+}
+
+
+term_id TermStore::leaf(Term term)
+{
+	return insert(term, INVALID_TERM, INVALID_TERM);
+}
+
+
+term_id TermStore::function(operation_t op, term_id left, term_id right)
+{
+	return insert(Term(term_t::Function, op), left, right);
+}
+
+
+term_id TermStore::intern(const Expression &expression)
+{
+	if (expression.empty())
+	{
+		return INVALID_TERM;
+	}
+
+	// children follow parents in preorder layout
+	std::vector<term_id> ids(expression.size(), INVALID_TERM);
+	for (std::size_t idx = expression.size(); idx-- > 0;)
+	{
+		const auto rel = expression.subtree(idx);
+		ids[idx] = insert(
+			expression[idx],
+			rel.left() == INVALID_INDEX ? INVALID_TERM : ids[rel.left()],
+			rel.right() == INVALID_INDEX ? INVALID_TERM : ids[rel.right()]
+		);
+	}
+
+	return ids[0];
+}
+
+
+term_id TermStore::find(const Expression &expression) const
+{
+	if (expression.empty())
+	{
+		return INVALID_TERM;
+	}
+
+	// children follow parents in preorder layout
+	std::vector<term_id> ids(expression.size(), INVALID_TERM);
+	for (std::size_t idx = expression.size(); idx-- > 0;)
+	{
+		const auto rel = expression.subtree(idx);
+		const auto it = table_.find(key(
+			expression[idx],
+			rel.left() == INVALID_INDEX ? INVALID_TERM : ids[rel.left()],
+			rel.right() == INVALID_INDEX ? INVALID_TERM : ids[rel.right()]
+		));
+
+		// expression is not stored if any of subtrees is not
+		if (it == table_.end())
+		{
+			return INVALID_TERM;
+		}
+
+		ids[idx] = it->second;
+	}
+
+	return ids[0];
+}
+
+
+Expression TermStore::expression(term_id id) const
+{
+	if (id == INVALID_TERM)
+	{
+		return {};
+	}
+
+	std::vector<Term> preorder;
+	preorder.reserve(size(id));
+
+	std::vector<term_id> s;
+	s.push_back(id);
+
+	while (!s.empty())
+	{
+		const auto current = s.back();
+		s.pop_back();
+
+		preorder.push_back(term(current));
+
+		if (right(current) != INVALID_TERM)
+		{
+			s.push_back(right(current));
+		}
+		if (left(current) != INVALID_TERM)
+		{
+			s.push_back(left(current));
+		}
+	}
+
+	return Expression{preorder};
+}
+
+
+void TermStore::render(std::string &out, term_id id, bool root) const
+{
+	// closing bracket is postponed as a separate action
+	constexpr const term_id CLOSE_BRACKET = INVALID_TERM - 1;
+
+	// node is printed when it's popped the second time, after its left subtree
+	std::vector<std::pair<term_id, bool>> s;
+	s.emplace_back(id, false);
+
+	while (!s.empty())
+	{
+		const auto [current, visited] = s.back();
+		s.pop_back();
+
+		if (current == CLOSE_BRACKET)
+		{
+			out += ')';
+			continue;
+		}
+
+		if (current == INVALID_TERM)
+		{
+			continue;
+		}
+
+		if (visited)
+		{
+			out += term(current).to_string();
+			s.emplace_back(right(current), false);
+			continue;
+		}
+
+		const bool brackets = !(root && current == id) && term(current).type == term_t::Function;
+		if (brackets)
+		{
+			out += '(';
+			s.emplace_back(CLOSE_BRACKET, false);
+		}
+
+		s.emplace_back(current, true);
+		s.emplace_back(left(current), false);
+	}
+}
+
+
+std::string TermStore::to_string(term_id id) const
+{
+	if (id == INVALID_TERM)
+	{
+		return "empty";
+	}
+
+	std::string representation;
+	representation.reserve(2 * size(id));
+	render(representation, id, true);
+	return representation;
+}
+
+
+std::size_t TermStore::memory() const noexcept
+{
+	// node of hash table holds next pointer and cached hash besides its value
+	const auto node = sizeof(std::pair<const Key, term_id>) + 2 * sizeof(void *);
+
+	return entries_.capacity() * sizeof(Entry) +
+		negations_.capacity() * sizeof(term_id) +
+		table_.size() * node +
+		table_.bucket_count() * sizeof(void *);
+}
+
+
+std::size_t TermStore::operations(term_id id, operation_t op) const
+{
+	std::size_t count = 0;
+
+	std::vector<term_id> s;
+	s.push_back(id);
+
+	while (!s.empty())
+	{
+		const auto current = s.back();
+		s.pop_back();
+
+		if (current == INVALID_TERM || term(current).type != term_t::Function)
+		{
+			continue;
+		}
+
+		count += term(current).op == op ? 1 : 0;
+		s.push_back(right(current));
+		s.push_back(left(current));
+	}
+
+	return count;
+}
+
+
+void TermStore::collect_variables(term_id id, std::vector<value_t> &vars) const
+{
+	// variables are leaves, so preorder keeps their order of occurrence
+	std::vector<term_id> s;
+	s.push_back(id);
+
+	while (!s.empty())
+	{
+		const auto current = s.back();
+		s.pop_back();
+
+		if (current == INVALID_TERM)
+		{
+			continue;
+		}
+
+		if (term(current).type == term_t::Variable)
+		{
+			vars.push_back(term(current).value);
+		}
+
+		s.push_back(right(current));
+		s.push_back(left(current));
+	}
+}
+
+
+std::vector<value_t> TermStore::variables(term_id id) const
+{
+	std::vector<value_t> vars;
+	if (id != INVALID_TERM)
+	{
+		vars.reserve(size(id));
+	}
+
+	collect_variables(id, vars);
+	return vars;
+}
+
+
+bool TermStore::contains(term_id id, value_t value) const
+{
+	std::vector<term_id> s;
+	s.push_back(id);
+
+	while (!s.empty())
+	{
+		const auto current = s.back();
+		s.pop_back();
+
+		// subtree without such large value is skipped
+		if (current == INVALID_TERM || max_value(current) < value)
+		{
+			continue;
+		}
+
+		if (term(current).type == term_t::Variable)
+		{
+			if (term(current).value == value)
+			{
+				return true;
+			}
+			continue;
+		}
+
+		s.push_back(right(current));
+		s.push_back(left(current));
+	}
+
+	return false;
+}
+
+
+bool TermStore::equals(term_id lhs, term_id rhs, bool var_ignore) const
+{
+	std::vector<std::pair<term_id, term_id>> s;
+	s.emplace_back(lhs, rhs);
+
+	while (!s.empty())
+	{
+		const auto [l_id, r_id] = s.back();
+		s.pop_back();
+
+		if (l_id == r_id)
+		{
+			continue;
+		}
+
+		if (l_id == INVALID_TERM || r_id == INVALID_TERM ||
+			size(l_id) != size(r_id))
+		{
+			return false;
+		}
+
+		const auto &l = term(l_id);
+		const auto &r = term(r_id);
+
+		if ((l.type == term_t::Function) != (r.type == term_t::Function))
+		{
+			return false;
+		}
+
+		if (!var_ignore && l.type != r.type)
+		{
+			return false;
+		}
+
+		if (l.value != r.value || l.op != r.op)
+		{
+			return false;
+		}
+
+		s.emplace_back(right(l_id), right(r_id));
+		s.emplace_back(left(l_id), left(r_id));
+	}
+
+	return true;
+}
+
+
+term_id TermStore::negation(term_id id)
+{
+	if (id == INVALID_TERM)
+	{
+		return INVALID_TERM;
+	}
+
+	// node is negated when it's popped the second time, after subtrees it needs
+	std::vector<std::pair<term_id, bool>> s;
+	s.emplace_back(id, false);
+
+	while (!s.empty())
+	{
+		const auto [current, expanded] = s.back();
+
+		if (negations_[current] != INVALID_TERM)
+		{
+			s.pop_back();
+			continue;
+		}
+
+		auto node = term(current);
+
+		if (node.type != term_t::Function)
+		{
+			s.pop_back();
+			node.op = node.op == operation_t::Negation ?
+				operation_t::Nop :
+				operation_t::Negation;
+			const auto result = leaf(node);
+			negations_[current] = result;
+			continue;
+		}
+
+		const auto negation = negate_operation(node.op);
+		const auto op = negation.op;
+		const bool negate_left = negation.left;
+		const bool negate_right = negation.right;
+
+		if (!expanded)
+		{
+			s.back().second = true;
+			if (negate_right)
+			{
+				s.emplace_back(right(current), false);
+			}
+			if (negate_left)
+			{
+				s.emplace_back(left(current), false);
+			}
+			continue;
+		}
+
+		s.pop_back();
+		const auto result = function(
+			op,
+			negate_left ? negations_[left(current)] : left(current),
+			negate_right ? negations_[right(current)] : right(current)
+		);
+		negations_[current] = result;
+	}
+
+	return negations_[id];
+}
+
+
+term_id TermStore::rename(
+	term_id id,
+	const std::unordered_map<value_t, value_t> &remapping
+)
+{
+	if (id == INVALID_TERM)
+	{
+		return INVALID_TERM;
+	}
+
+	// renamed subtrees wait for their parent, which is popped the second time
+	std::vector<std::pair<term_id, bool>> s;
+	std::vector<term_id> renamed;
+	s.emplace_back(id, false);
+
+	while (!s.empty())
+	{
+		const auto [current, expanded] = s.back();
+		s.pop_back();
+
+		auto node = term(current);
+		if (node.type == term_t::Variable)
+		{
+			node.value = remapping.at(node.value);
+			renamed.push_back(leaf(node));
+			continue;
+		}
+
+		// subtree without variables stays the same
+		if (node.type != term_t::Function || max_value(current) == 0)
+		{
+			renamed.push_back(current);
+			continue;
+		}
+
+		if (!expanded)
+		{
+			s.emplace_back(current, true);
+			s.emplace_back(right(current), false);
+			s.emplace_back(left(current), false);
+			continue;
+		}
+
+		const auto r = renamed.back();
+		renamed.pop_back();
+		const auto l = renamed.back();
+		renamed.pop_back();
+		renamed.push_back(function(node.op, l, r));
+	}
+
+	return renamed.back();
+}
+
+
+term_id TermStore::normalize(term_id id)
+{
+	if (id == INVALID_TERM)
+	{
+		return INVALID_TERM;
+	}
+
+	std::unordered_map<value_t, value_t> remapping;
+	value_t new_value = 1;
+	bool identity = true;
+
+	for (const auto &entry : variables(id))
+	{
+		if (remapping.contains(entry))
+		{
+			continue;
+		}
+
+		identity = identity && entry == new_value;
+		remapping[entry] = new_value;
+		++new_value;
+	}
+
+	// already canonical, nothing to store
+	if (identity)
+	{
+		return id;
+	}
+
+	return rename(id, remapping);
+}
@@ -0,0 +1,140 @@
+#ifndef TERM_STORE_HPP
+#define TERM_STORE_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "ast.hpp"
+
+
+using term_id = std::uint32_t;
+constexpr const term_id INVALID_TERM = static_cast<term_id>(-1);
+
+
+/**
+ * @brief hash-consing storage of formulas
+ *
+ * @note every distinct subformula is stored exactly once, so a formula is
+ * fully identified by its `term_id`: copies are free and two formulas are
+ * structurally equal iff their ids are equal
+ */
+class TermStore
+{
+	struct Entry
+	{
+		// structural hash of the whole subtree
+		std::uint64_t hash;
+
+		term_id left;
+		term_id right;
+
+		// number of nodes and max variable value of the whole subtree
+		std::uint32_t size;
+		value_t max_value;
+
+		// term packed as in Expression
+		value_t value;
+		std::uint8_t tag;
+	};
+	static_assert(sizeof(Entry) == 32);
+
+	struct Key
+	{
+		term_id left;
+		term_id right;
+		value_t value;
+		std::uint8_t tag;
+
+		bool operator==(const Key &other) const noexcept
+		{
+			return tag == other.tag &&
+				value == other.value &&
+				left == other.left &&
+				right == other.right;
+		}
+	};
+	static_assert(sizeof(Key) == 16);
+
+	struct KeyHash
+	{
+		std::size_t operator()(const Key &key) const noexcept;
+	};
+
+	std::vector<Entry> entries_;
+	std::unordered_map<Key, term_id, KeyHash> table_;
+
+	// memoized negations, INVALID_TERM if not calculated yet
+	std::vector<term_id> negations_;
+
+	static Key key(Term term, term_id left, term_id right) noexcept;
+
+	term_id insert(Term term, term_id left, term_id right);
+	void collect_variables(term_id id, std::vector<value_t> &vars) const;
+	void render(std::string &out, term_id id, bool root) const;
+	term_id rename(term_id id, const std::unordered_map<value_t, value_t> &remapping);
+public:
+	TermStore();
+
+	// construction
+	term_id leaf(Term term);
+	term_id function(operation_t op, term_id left, term_id right);
+	term_id intern(const Expression &expression);
+
+	// lookup without insertion, INVALID_TERM if expression is not stored
+	term_id find(const Expression &expression) const;
+
+	// conversion back to tree representation
+	Expression expression(term_id id) const;
+	std::string to_string(term_id id) const;
+
+	// general information
+	inline Term term(term_id id) const
+	{
+		const auto &entry = entries_[id];
+		return Term(tag_type(entry.tag), tag_op(entry.tag), entry.value);
+	}
+	inline term_id left(term_id id) const { return entries_[id].left; }
+	inline term_id right(term_id id) const { return entries_[id].right; }
+	inline std::size_t size(term_id id) const { return entries_[id].size; }
+	inline value_t max_value(term_id id) const { return entries_[id].max_value; }
+	inline std::uint64_t hash(term_id id) const { return entries_[id].hash; }
+	inline std::size_t terms() const noexcept { return entries_.size(); }
+
+	// approximate bytes of heap memory held by store
+	std::size_t memory() const noexcept;
+
+	std::size_t operations(term_id id, operation_t op) const;
+	std::vector<value_t> variables(term_id id) const;
+
+	// does subtree contain variable with certain value?
+	bool contains(term_id id, value_t value) const;
+
+	// compare with other tree, var_ignore skips variable/constant distinction
+	bool equals(term_id lhs, term_id rhs, bool var_ignore = true) const;
+
+	// applying negation to whole subtree
+	term_id negation(term_id id);
+
+	// rename variables in order of first occurrence
+	term_id normalize(term_id id);
+};
+
+
+/**
+ * @brief hash of normalized stored expression
+ *
+ * @note hash of normalized expression is variable renaming invariant,
+ * two normalized expressions are equal iff their ids are equal
+ */
+struct CanonicalHash
+{
+	const TermStore *store;
+
+	inline std::size_t operator()(term_id id) const noexcept
+	{
+		return static_cast<std::size_t>(store->hash(id));
+	}
+};
+
+#endif // TERM_STORE_HPP
@@ -39,22 +39,28 @@ std::int32_t priority(operation_t op)
 ExpressionParser::ExpressionParser(std::string_view expression)
 	: brackets(0)
 	, expression(expression)
+	, nodes{}
 	, operands{}
 	, operations{}
-{}
+{
+	nodes.reserve(expression.size());
+}
 
 
 void ExpressionParser::construct_node()
 {
 	if (operations.top() == Token::Negation)
 	{
-		// extract nodes
-		auto operand = operands.top();
-		operands.pop();
+		if (operands.empty())
+		{
+			throw std::runtime_error("something went wrong in construct node");
+		}
+
 		operations.pop();
 
-		operand.negation();
-		operands.push(operand);
+		// negation of whole subtree is postponed until emission
+		auto &operand = nodes[operands.top()];
+		operand.negated = !operand.negated;
 		return;
 	}
 
@@ -71,15 +77,64 @@ void ExpressionParser::construct_node()
 	}
 
 	// extract nodes
-	auto rhs = operands.top();
+	const auto rhs = operands.top();
 	operands.pop();
 	const auto op = static_cast<operation_t>(operations.top());
 	operations.pop();
-	auto lhs = operands.top();
+	const auto lhs = operands.top();
 	operands.pop();
 
 	// add produced node
-	operands.emplace(Expression::construct(lhs, op, rhs));
+	operands.push(nodes.size());
+	nodes.push_back({Term(term_t::Function, op), lhs, rhs, false});
+}
+
+
+Expression ExpressionParser::emit(std::size_t root) const
+{
+	std::vector<Term> preorder;
+	preorder.reserve(nodes.size());
+
+	std::vector<std::pair<std::size_t, bool>> s;
+	s.emplace_back(root, nodes[root].negated);
+
+	while (!s.empty())
+	{
+		const auto [idx, negated] = s.back();
+		s.pop_back();
+
+		const auto &node = nodes[idx];
+		auto term = node.term;
+
+		if (term.type != term_t::Function)
+		{
+			if (negated)
+			{
+				term.op = term.op == operation_t::Negation ?
+					operation_t::Nop :
+					operation_t::Negation;
+			}
+
+			preorder.push_back(term);
+			continue;
+		}
+
+		bool negate_left = false;
+		bool negate_right = false;
+		if (negated)
+		{
+			const auto negation = negate_operation(term.op);
+			term.op = negation.op;
+			negate_left = negation.left;
+			negate_right = negation.right;
+		}
+
+		preorder.push_back(term);
+		s.emplace_back(node.right, nodes[node.right].negated != negate_right);
+		s.emplace_back(node.left, nodes[node.left].negated != negate_left);
+	}
+
+	return Expression{preorder};
 }
 
 
@@ -174,7 +229,8 @@ Expression ExpressionParser::parse()
 		else
 		{
 			last_token_is_op = false;
-			operands.emplace(determine_operand(token));
+			operands.push(nodes.size());
+			nodes.push_back({determine_operand(token), INVALID_INDEX, INVALID_INDEX, false});
 		}
 	}
 
@@ -183,5 +239,10 @@ Expression ExpressionParser::parse()
 		construct_node();
 	}
 
-	return operands.top();
+	if (operands.empty())
+	{
+		throw std::runtime_error("empty expression");
+	}
+
+	return emit(operands.top());
 }
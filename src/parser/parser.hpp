@@ -5,6 +5,7 @@
 #include <cstdint>
 #include <stack>
 #include <string>
+#include <vector>
 #include "../math/ast.hpp"
 
 
@@ -24,6 +25,19 @@ enum class Token : std::int32_t
 
 class ExpressionParser
 {
+	/**
+	 * node of parsed tree, negations are applied lazily on emission
+	 */
+	struct Node
+	{
+		Term term;
+		std::size_t left;
+		std::size_t right;
+
+		// subtree is negated odd number of times, !!a = a
+		bool negated;
+	};
+
 	/**
 	 * number of brackets `(` ~ `+1`; `)` ~ `-1`
 	 */
@@ -34,16 +48,22 @@ class ExpressionParser
 	 */
 	std::string_view expression;
 
+	/**
+	 * every node is created once, operands refer to it by index
+	 */
+	std::vector<Node> nodes;
+
 	/**
 	 * stacks for rpn
 	 */
-	std::stack<Expression> operands;
+	std::stack<std::size_t> operands;
 	std::stack<Token> operations;
 
 	/**
 	 * helper functions
 	 */
 	void construct_node();
+	Expression emit(std::size_t root) const;
 	bool is_operation(char token);
 	operation_t determine_operation(char token);
 	Term determine_operand(char token);
@@ -0,0 +1,88 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include "./checker/proof_checker.hpp"
+
+
+// proofs of every file (or of stdin) are checked as one stream,
+// `--rule NAME SCHEMA` adds derived rule to standard ones
+int main(int argc, char *argv[])
+{
+	std::ios::sync_with_stdio(false);
+
+	auto rules = standard_rules();
+	std::vector<std::string> paths;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::string_view(argv[i]) == "--rule" && i + 2 < argc)
+		{
+			try
+			{
+				rules.push_back(compile_rule(argv[i + 1], argv[i + 2]));
+			}
+			catch (const std::invalid_argument &e)
+			{
+				std::cerr << e.what() << '\n';
+				return 2;
+			}
+
+			i += 2;
+			continue;
+		}
+
+		paths.emplace_back(argv[i]);
+	}
+
+	std::size_t proofs = 0;
+	std::size_t proved = 0;
+	std::size_t failed = 0;
+
+	auto check = [&] (std::istream &in, const std::string &name)
+	{
+		ProofChecker checker([&] (const CheckResult &result)
+		{
+			++proofs;
+
+			if (!result.error.empty())
+			{
+				++failed;
+				std::cout << name << ": " << result.error << " (input " << result.input << ")\n";
+			}
+			else if (result.proved)
+			{
+				++proved;
+			}
+		}, {}, rules);
+
+		for (std::string line; std::getline(in, line);)
+		{
+			checker.feed(line);
+		}
+
+		checker.finish();
+	};
+
+	if (paths.empty())
+	{
+		check(std::cin, "stdin");
+	}
+
+	for (const auto &path : paths)
+	{
+		std::ifstream in(path);
+		if (!in)
+		{
+			std::cerr << "[-] error: can't open " << path << '\n';
+			return 2;
+		}
+
+		check(in, path);
+	}
+
+	std::cout << "checked " << proofs << " proofs: " << proved << " valid, "
+		<< failed << " invalid, " << proofs - proved - failed << " without proof\n";
+	return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,70 @@
+#include <chrono>
+#include <stdexcept>
+#include "batch.hpp"
+#include "solver.hpp"
+#include "thread_pool.hpp"
+
+
+std::vector<BatchResult> prove_batch(
+	const std::vector<std::string> &targets,
+	const std::vector<Expression> &axioms,
+	LemmaBase &lemmas,
+	const LemmaStore *store,
+	std::size_t threads,
+	const SolverOptions &options,
+	const CancellationToken &token
+)
+{
+	std::vector<BatchResult> results(targets.size());
+	ThreadPool pool(threads);
+
+	pool.run(targets.size(), [&] (std::size_t task, std::size_t)
+	{
+		auto &result = results[task];
+		result.input = targets[task];
+		result.proved = false;
+		result.stop = StopReason::None;
+
+		const auto start = std::chrono::steady_clock::now();
+
+		if (token.cancelled())
+		{
+			result.stop = StopReason::Cancelled;
+			result.thought_chain = "Search was cancelled before a proof was found\n";
+			result.time_ms = 0;
+			return;
+		}
+
+		try
+		{
+			Expression target(targets[task]);
+			target.standardize();
+			target.make_permanent();
+			result.normalized = target.to_string();
+
+			Solver solver(axioms, target);
+			solver.configure(options);
+			solver.set_cancellation(token);
+			solver.share_lemmas(lemmas);
+			if (store != nullptr)
+			{
+				solver.use_store(*store);
+			}
+			solver.solve();
+
+			result.thought_chain = solver.thought_chain();
+			result.proved = solver.proved();
+			result.stop = solver.stop_reason();
+		}
+		catch (const std::exception &e)
+		{
+			result.thought_chain = std::string("[-] error: ") + e.what() + '\n';
+		}
+
+		result.time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now() - start
+		).count();
+	});
+
+	return results;
+}
@@ -0,0 +1,46 @@
+#ifndef BATCH_HPP
+#define BATCH_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../math/ast.hpp"
+#include "lemma_base.hpp"
+#include "lemma_store.hpp"
+#include "governor.hpp"
+#include "solver.hpp"
+
+
+struct BatchResult
+{
+	std::string input;
+	std::string normalized;
+	std::string thought_chain;
+	bool proved;
+
+	// why search of unproved target was stopped
+	StopReason stop;
+	std::uint64_t time_ms;
+};
+
+
+/**
+ * @brief prove every target on `threads` workers
+ *
+ * @note every target is solved by its own single-threaded solver, steps of
+ * found proofs which are valid without hypotheses are shared between them.
+ * Every solver is configured by `options`.
+ * Results are in order of targets, shared lemmas are left in `lemmas`.
+ * Cancelled `token` stops running solvers and skips targets not started yet.
+ */
+std::vector<BatchResult> prove_batch(
+	const std::vector<std::string> &targets,
+	const std::vector<Expression> &axioms,
+	LemmaBase &lemmas,
+	const LemmaStore *store = nullptr,
+	std::size_t threads = 1,
+	const SolverOptions &options = {},
+	const CancellationToken &token = CancellationToken()
+);
+
+#endif // BATCH_HPP
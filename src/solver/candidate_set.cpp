@@ -0,0 +1,84 @@
+#include <algorithm>
+#include "candidate_set.hpp"
+
+
+CandidateSet::CandidateSet(std::size_t shards)
+{
+	shards = std::max<std::size_t>(shards, 1);
+
+	for (std::size_t i = 0; i < shards; ++i)
+	{
+		shards_.push_back(std::make_unique<Shard>());
+	}
+}
+
+
+CandidateSet::Shard &CandidateSet::shard(std::uint64_t hash) noexcept
+{
+	// low bits are used by buckets of shard itself
+	return *shards_[(hash >> 48) % shards_.size()];
+}
+
+
+bool CandidateSet::insert(
+	std::uint64_t hash,
+	std::uint64_t order,
+	const Expression &expression
+)
+{
+	auto &s = shard(hash);
+	std::lock_guard lock(s.mutex);
+
+	auto [begin, end] = s.entries.equal_range(hash);
+	for (auto it = begin; it != end; ++it)
+	{
+		// exact tiebreak of equal hashes
+		if (!it->second.expression->equals(expression, false))
+		{
+			continue;
+		}
+
+		if (it->second.order < order)
+		{
+			return false;
+		}
+
+		it->second = {order, &expression};
+		return true;
+	}
+
+	s.entries.emplace(hash, Entry{order, &expression});
+	return true;
+}
+
+
+bool CandidateSet::owns(
+	std::uint64_t hash,
+	std::uint64_t order,
+	const Expression &expression
+)
+{
+	auto &s = shard(hash);
+	std::lock_guard lock(s.mutex);
+
+	auto [begin, end] = s.entries.equal_range(hash);
+	for (auto it = begin; it != end; ++it)
+	{
+		if (it->second.expression->equals(expression, false))
+		{
+			return it->second.order == order;
+		}
+	}
+
+	return false;
+}
+
+
+void CandidateSet::clear()
+{
+	for (auto &s : shards_)
+	{
+		std::lock_guard lock(s->mutex);
+		s->entries.clear();
+	}
+}
@@ -0,0 +1,54 @@
+#ifndef CANDIDATE_SET_HPP
+#define CANDIDATE_SET_HPP
+
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "../math/ast.hpp"
+
+
+/**
+ * @brief concurrent set of normalized expressions produced in one generation
+ *
+ * @note of equal expressions the one with the smallest order is kept
+ * regardless of insertion order, so the content is deterministic
+ */
+class CandidateSet
+{
+	struct Entry
+	{
+		std::uint64_t order;
+		const Expression *expression;
+	};
+
+	struct Shard
+	{
+		std::mutex mutex;
+		std::unordered_multimap<std::uint64_t, Entry> entries;
+	};
+
+	std::vector<std::unique_ptr<Shard>> shards_;
+
+	Shard &shard(std::uint64_t hash) noexcept;
+public:
+	explicit CandidateSet(std::size_t shards = 64);
+
+	/**
+	 * @brief insert expression with its canonical hash
+	 *
+	 * @note `expression` must outlive the set
+	 *
+	 * @return Returns `false` if equal expression with smaller order
+	 * is already inserted, `true` otherwise.
+	 */
+	bool insert(std::uint64_t hash, std::uint64_t order, const Expression &expression);
+
+	// is expression inserted with `order` the one that was kept?
+	bool owns(std::uint64_t hash, std::uint64_t order, const Expression &expression);
+
+	void clear();
+};
+
+#endif // CANDIDATE_SET_HPP
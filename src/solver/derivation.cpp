@@ -0,0 +1,286 @@
+#include <stdexcept>
+#include "derivation.hpp"
+#include "../math/helper.hpp"
+#include "../math/rules.hpp"
+
+
+namespace
+{
+
+constexpr const std::size_t NO_LINE = static_cast<std::size_t>(-1);
+
+
+// same expression where every constant is variable
+term_id generalize(TermStore &store, term_id id)
+{
+	auto term = store.term(id);
+	if (term.type == term_t::Function)
+	{
+		const auto left = generalize(store, store.left(id));
+		const auto right = generalize(store, store.right(id));
+		return store.function(term.op, left, right);
+	}
+
+	if (term.type == term_t::Constant)
+	{
+		term.type = term_t::Variable;
+		return store.leaf(term);
+	}
+
+	return id;
+}
+
+}
+
+
+const std::vector<Expression> &hilbert_axioms()
+{
+	static const std::vector<Expression> axioms = {
+		Expression("a>(b>a)"),
+		Expression("(a>(b>c))>((a>b)>(a>c))"),
+		Expression("(!a>!b)>((!a>b)>a)")
+	};
+
+	return axioms;
+}
+
+
+Derivation::Derivation(TermStore &store)
+	: store_(&store)
+	, schemas_()
+	, lines_()
+	, index_()
+	, goal_(NO_LINE)
+{
+	for (const auto &axiom : hilbert_axioms())
+	{
+		schemas_.push_back(store.intern(axiom));
+	}
+}
+
+
+std::size_t Derivation::add(const Line &line)
+{
+	const auto [it, inserted] = index_.try_emplace(line.fact, lines_.size());
+	if (inserted)
+	{
+		lines_.push_back(line);
+	}
+
+	goal_ = it->second;
+	return goal_;
+}
+
+
+std::size_t Derivation::axiom(std::size_t k, term_id a, term_id b, term_id c)
+{
+	const std::vector<term_id> bindings = {INVALID_TERM, a, b, c};
+	return add({substitute(*store_, schemas_[k], bindings, 0), line_t::Axiom, 0, 0});
+}
+
+
+std::size_t Derivation::axiom_instance(term_id fact)
+{
+	return add({fact, line_t::Axiom, 0, 0});
+}
+
+
+bool Derivation::is_mp(std::size_t line, std::size_t &premise, std::size_t &implication) const
+{
+	if (lines_[line].type != line_t::ModusPonens)
+	{
+		return false;
+	}
+
+	premise = lines_[line].premise;
+	implication = lines_[line].implication;
+	return true;
+}
+
+
+std::size_t Derivation::hypothesis(term_id fact)
+{
+	return add({fact, line_t::Hypothesis, 0, 0});
+}
+
+
+std::size_t Derivation::mp(std::size_t premise, std::size_t implication, term_id expected)
+{
+	const auto consequence = modus_ponens(*store_, lines_[premise].fact, lines_[implication].fact);
+	if (consequence.empty())
+	{
+		throw std::runtime_error("[-] error: modus ponens isn't applicable in derivation");
+	}
+
+	auto fact = store_->intern(consequence);
+	if (expected != INVALID_TERM)
+	{
+		if (!matches(*store_, fact, expected))
+		{
+			throw std::runtime_error("[-] error: " + store_->to_string(expected) +
+				" isn't an instance of " + store_->to_string(fact));
+		}
+
+		fact = expected;
+	}
+
+	return add({fact, line_t::ModusPonens, premise, implication});
+}
+
+
+std::size_t Derivation::identity(term_id h)
+{
+	const auto hh = store_->function(operation_t::Implication, h, h);
+
+	const auto step = mp(axiom(0, h, hh), axiom(1, h, hh, h));
+	return mp(axiom(0, h, h), step);
+}
+
+
+std::size_t Derivation::append(const Derivation &other, bool general)
+{
+	std::vector<std::size_t> lines(other.lines_.size());
+
+	for (std::size_t i = 0; i < other.lines_.size(); ++i)
+	{
+		auto line = other.lines_[i];
+		if (general)
+		{
+			line.fact = generalize(*store_, line.fact);
+		}
+
+		if (line.type == line_t::ModusPonens)
+		{
+			line.premise = lines[line.premise];
+			line.implication = lines[line.implication];
+		}
+
+		lines[i] = add(line);
+	}
+
+	goal_ = lines[other.goal_];
+	return goal_;
+}
+
+
+Derivation Derivation::discharge(term_id h) const
+{
+	Derivation result(*store_);
+	auto &store = *store_;
+
+	auto conditional_fact = [&] (term_id fact)
+	{
+		return store.function(operation_t::Implication, h, fact);
+	};
+
+	// index of line itself if it doesn't depend on `h` and of h > line
+	std::vector<std::size_t> plain(lines_.size(), NO_LINE);
+	std::vector<std::size_t> conditional(lines_.size(), NO_LINE);
+
+	auto lift = [&] (std::size_t i)
+	{
+		if (conditional[i] == NO_LINE)
+		{
+			const auto weakening = result.axiom(0, lines_[i].fact, h);
+			conditional[i] = result.mp(plain[i], weakening, conditional_fact(lines_[i].fact));
+		}
+
+		return conditional[i];
+	};
+
+	for (std::size_t i = 0; i < lines_.size(); ++i)
+	{
+		const auto &line = lines_[i];
+
+		if (line.type == line_t::Hypothesis && line.fact == h)
+		{
+			conditional[i] = result.identity(h);
+			continue;
+		}
+
+		if (line.type != line_t::ModusPonens)
+		{
+			plain[i] = result.add(line);
+			continue;
+		}
+
+		const auto p = line.premise;
+		const auto q = line.implication;
+
+		if (plain[p] != NO_LINE && plain[q] != NO_LINE)
+		{
+			plain[i] = result.mp(plain[p], plain[q], line.fact);
+			continue;
+		}
+
+		// (h > (B > C)) > ((h > B) > (h > C)), B and C stay variables if lines are schematic,
+		// so their variables aren't merged, ground lines keep the whole derivation ground
+		const auto premise = plain[p] == NO_LINE ? conditional[p] : lift(p);
+		const auto implication = plain[q] == NO_LINE ? conditional[q] : lift(q);
+		const bool ground = store.max_value(lines_[p].fact) == 0 && store.max_value(line.fact) == 0;
+		const auto distribution = ground ?
+			result.axiom(1, h, lines_[p].fact, line.fact) :
+			result.axiom(1, h);
+		const auto distributed = result.mp(implication, distribution);
+
+		conditional[i] = result.mp(premise, distributed, conditional_fact(line.fact));
+	}
+
+	result.goal_ = plain[goal_] == NO_LINE ? conditional[goal_] : lift(goal_);
+	return result;
+}
+
+
+std::string Derivation::to_string(std::size_t first) const
+{
+	std::string result;
+	if (goal_ == NO_LINE)
+	{
+		return result;
+	}
+
+	// lines which goal depends on, mp refers to previous lines only,
+	// so goal is the last of them even if it was derived before others
+	std::vector<bool> used(goal_ + 1, false);
+	used[goal_] = true;
+	for (std::size_t i = goal_ + 1; i-- > 0;)
+	{
+		if (used[i] && lines_[i].type == line_t::ModusPonens)
+		{
+			used[lines_[i].premise] = true;
+			used[lines_[i].implication] = true;
+		}
+	}
+
+	std::vector<std::size_t> number(goal_ + 1, NO_LINE);
+	std::size_t next = first;
+
+	for (std::size_t i = 0; i <= goal_; ++i)
+	{
+		if (!used[i])
+		{
+			continue;
+		}
+
+		const auto &line = lines_[i];
+		number[i] = next++;
+		result += std::to_string(number[i]) + ". ";
+
+		switch (line.type)
+		{
+		case line_t::Axiom:
+			result += "axiom";
+			break;
+		case line_t::ModusPonens:
+			result += "mp(" + std::to_string(number[line.premise]) + "," +
+				std::to_string(number[line.implication]) + ")";
+			break;
+		default:
+			throw std::runtime_error("[-] error: hypothesis isn't discharged in derivation");
+		}
+
+		result += ": " + store_->to_string(line.fact) + '\n';
+	}
+
+	return result;
+}
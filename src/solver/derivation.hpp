@@ -0,0 +1,99 @@
+#ifndef DERIVATION_HPP
+#define DERIVATION_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include "../math/ast.hpp"
+#include "../math/term_store.hpp"
+
+
+// axioms of Hilbert system which derivations are built from
+const std::vector<Expression> &hilbert_axioms();
+
+
+/**
+ * @brief Hilbert derivation which may use hypotheses until they're discharged
+ *
+ * @note lines are `axiom`, hypothesis or mp of previous lines, every fact is
+ * derived once. Goal is the fact of the last added line unless it's set by
+ * `append` or `discharge`
+ */
+class Derivation
+{
+	enum class line_t : std::uint8_t
+	{
+		Axiom,
+		Hypothesis,
+		ModusPonens
+	};
+
+	struct Line
+	{
+		term_id fact;
+		line_t type;
+		std::size_t premise;
+		std::size_t implication;
+	};
+
+	TermStore *store_;
+	std::vector<term_id> schemas_;
+	std::vector<Line> lines_;
+	std::unordered_map<term_id, std::size_t> index_;
+	std::size_t goal_;
+
+	std::size_t add(const Line &line);
+public:
+	explicit Derivation(TermStore &store);
+
+	inline TermStore &store() const noexcept { return *store_; }
+	inline std::size_t size() const noexcept { return lines_.size(); }
+	inline std::size_t goal() const noexcept { return goal_; }
+	inline term_id fact(std::size_t line) const { return lines_[line].fact; }
+
+	// line of fact derived before
+	inline std::size_t line(term_id fact) const { return index_.at(fact); }
+
+	// is line mp of previous lines, their indices are set if it is
+	bool is_mp(std::size_t line, std::size_t &premise, std::size_t &implication) const;
+
+	// instance of k-th axiom of `hilbert_axioms`, unbound variables are kept
+	std::size_t axiom(std::size_t k, term_id a = INVALID_TERM, term_id b = INVALID_TERM, term_id c = INVALID_TERM);
+
+	// fact which caller knows to be an instance of axiom schema or proved elsewhere,
+	// line of fact if it's derived already
+	std::size_t axiom_instance(term_id fact);
+
+	std::size_t hypothesis(term_id fact);
+
+	/**
+	 * @brief modus ponens of premise and implication lines
+	 * @note `expected` instance of consequence is kept instead of it,
+	 * throws std::runtime_error if mp isn't applicable
+	 */
+	std::size_t mp(std::size_t premise, std::size_t implication, term_id expected = INVALID_TERM);
+
+	// h > h
+	std::size_t identity(term_id h);
+
+	/**
+	 * @brief lines of other derivation of the same store, index of its goal
+	 * @note `general` turns constants into variables, so lemma derived
+	 * over constants becomes schema
+	 */
+	std::size_t append(const Derivation &other, bool general = false);
+
+	/**
+	 * @brief deduction theorem: Γ U {h} ⊢ goal => Γ ⊢ h > goal
+	 * @note every line which depends on `h` is replaced with h > line
+	 */
+	Derivation discharge(term_id h) const;
+
+	// `N. axiom: f` and `N. mp(i,j): f` lines which goal depends on numbered
+	// from `first`, goal is the last one, throws std::runtime_error if
+	// hypothesis isn't discharged
+	std::string to_string(std::size_t first = 1) const;
+};
+
+#endif // DERIVATION_HPP
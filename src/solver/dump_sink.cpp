@@ -0,0 +1,70 @@
+#include <stdexcept>
+#include "dump_sink.hpp"
+
+
+DumpSink::DumpSink(const std::string &path)
+	: out_(path)
+	, pending_()
+	, stop_(false)
+{
+	if (!out_)
+	{
+		throw std::runtime_error("[-] error: can't open dump file " + path);
+	}
+
+	thread_ = std::thread(&DumpSink::loop, this);
+}
+
+
+DumpSink::~DumpSink()
+{
+	{
+		std::lock_guard lock(mutex_);
+		stop_ = true;
+	}
+
+	ready_.notify_one();
+	thread_.join();
+}
+
+
+void DumpSink::write(std::string line)
+{
+	{
+		std::lock_guard lock(mutex_);
+		pending_.push_back(std::move(line));
+	}
+
+	ready_.notify_one();
+}
+
+
+void DumpSink::loop()
+{
+	std::vector<std::string> lines;
+
+	while (true)
+	{
+		{
+			std::unique_lock lock(mutex_);
+			ready_.wait(lock, [&] { return stop_ || !pending_.empty(); });
+
+			if (pending_.empty() && stop_)
+			{
+				break;
+			}
+
+			std::swap(lines, pending_);
+		}
+
+		// file is written without holding the lock
+		for (const auto &line : lines)
+		{
+			out_ << line << '\n';
+		}
+
+		lines.clear();
+	}
+
+	out_.flush();
+}
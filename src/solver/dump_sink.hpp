@@ -0,0 +1,38 @@
+#ifndef DUMP_SINK_HPP
+#define DUMP_SINK_HPP
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+
+/**
+ * @brief asynchronous line writer for debug dumps
+ *
+ * @note lines are written by background thread in order of `write` calls,
+ * everything written is flushed on destruction
+ */
+class DumpSink
+{
+	std::ofstream out_;
+	std::vector<std::string> pending_;
+	bool stop_;
+
+	std::mutex mutex_;
+	std::condition_variable ready_;
+	std::thread thread_;
+
+	void loop();
+public:
+	explicit DumpSink(const std::string &path);
+	DumpSink(const DumpSink &) = delete;
+	DumpSink &operator=(const DumpSink &) = delete;
+	~DumpSink();
+
+	void write(std::string line);
+};
+
+#endif // DUMP_SINK_HPP
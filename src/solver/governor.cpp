@@ -0,0 +1,181 @@
+#include <algorithm>
+#include "governor.hpp"
+
+
+namespace
+{
+
+// bounds of number of `stopped` calls between polls
+constexpr const std::int64_t MIN_PERIOD = 1;
+constexpr const std::int64_t MAX_PERIOD = 1 << 16;
+
+// polls closer than this are made rarer, further ones more frequent
+constexpr const std::chrono::microseconds MIN_INTERVAL(1000);
+constexpr const std::chrono::microseconds MAX_INTERVAL(4000);
+
+}
+
+
+const char *to_string(StopReason reason) noexcept
+{
+	switch (reason)
+	{
+	case StopReason::Deadline:
+		return "deadline";
+	case StopReason::Derivations:
+		return "derivation budget";
+	case StopReason::Memory:
+		return "memory budget";
+	case StopReason::Cancelled:
+		return "cancelled";
+	default:
+		return "none";
+	}
+}
+
+
+CancellationToken::CancellationToken()
+	: cancelled_(std::make_shared<std::atomic<bool>>(false))
+{
+}
+
+
+Governor::Governor(const Limits &limits)
+	: limits_(limits)
+	, memory_()
+	, token_()
+	, start_()
+	, deadline_()
+	, derivations_(0)
+	, countdown_(MIN_PERIOD)
+	, period_(MIN_PERIOD)
+	, last_poll_(0)
+	, reason_(StopReason::None)
+{
+	start();
+}
+
+
+void Governor::set_limits(const Limits &limits)
+{
+	limits_ = limits;
+	start();
+}
+
+
+void Governor::set_memory_probe(std::function<std::uint64_t()> probe)
+{
+	memory_ = std::move(probe);
+}
+
+
+void Governor::set_token(CancellationToken token)
+{
+	token_ = std::move(token);
+}
+
+
+Governor::clock::time_point Governor::limit_deadline() const
+{
+	const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(clock::time_point::max() - start_);
+	return limits_.time_ms >= static_cast<std::uint64_t>(left.count()) ?
+		clock::time_point::max() :
+		start_ + std::chrono::milliseconds(limits_.time_ms);
+}
+
+
+void Governor::start()
+{
+	start_ = clock::now();
+	deadline_ = limit_deadline();
+
+	derivations_.store(0, std::memory_order_relaxed);
+	countdown_.store(MIN_PERIOD, std::memory_order_relaxed);
+	period_.store(MIN_PERIOD, std::memory_order_relaxed);
+	last_poll_.store(start_.time_since_epoch().count(), std::memory_order_relaxed);
+	reason_.store(StopReason::None, std::memory_order_relaxed);
+}
+
+
+void Governor::shorten(std::uint64_t ms)
+{
+	const auto now = clock::now();
+	if (deadline_ - now > std::chrono::milliseconds(ms))
+	{
+		deadline_ = now + std::chrono::milliseconds(ms);
+	}
+}
+
+
+void Governor::resume()
+{
+	deadline_ = limit_deadline();
+
+	const auto reason = reason_.load(std::memory_order_relaxed);
+	if (reason == StopReason::Deadline || reason == StopReason::Derivations)
+	{
+		reason_.store(StopReason::None, std::memory_order_relaxed);
+	}
+
+	countdown_.store(MIN_PERIOD, std::memory_order_relaxed);
+}
+
+
+void Governor::stop(StopReason reason) noexcept
+{
+	// the first reason wins
+	auto expected = StopReason::None;
+	reason_.compare_exchange_strong(expected, reason, std::memory_order_relaxed);
+}
+
+
+StopReason Governor::poll()
+{
+	const auto now = clock::now();
+
+	// period is doubled or halved until polls are MIN_INTERVAL - MAX_INTERVAL apart
+	const auto last = clock::time_point(clock::duration(last_poll_.exchange(
+		now.time_since_epoch().count(),
+		std::memory_order_relaxed
+	)));
+
+	auto period = period_.load(std::memory_order_relaxed);
+	if (now - last < MIN_INTERVAL)
+	{
+		period = std::min(2 * period, MAX_PERIOD);
+	}
+	else if (now - last > MAX_INTERVAL)
+	{
+		period = std::max(period / 2, MIN_PERIOD);
+	}
+
+	period_.store(period, std::memory_order_relaxed);
+	countdown_.store(period, std::memory_order_relaxed);
+
+	if (token_.cancelled())
+	{
+		stop(StopReason::Cancelled);
+	}
+	else if (now >= deadline_)
+	{
+		stop(StopReason::Deadline);
+	}
+	else if (limits_.memory_bytes != UNLIMITED && memory_ && memory_() > limits_.memory_bytes)
+	{
+		stop(StopReason::Memory);
+	}
+
+	return reason();
+}
+
+
+bool Governor::check()
+{
+	return reason() != StopReason::None || poll() != StopReason::None;
+}
+
+
+std::uint64_t Governor::elapsed_ms() const
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - start_).count();
+}
@@ -0,0 +1,140 @@
+#ifndef GOVERNOR_HPP
+#define GOVERNOR_HPP
+
+#include <cstdint>
+#include <limits>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <functional>
+
+
+constexpr const std::uint64_t UNLIMITED = std::numeric_limits<std::uint64_t>::max();
+
+
+// why search was stopped before proof or saturation
+enum class StopReason : std::uint8_t
+{
+	None,
+	Deadline,
+	Derivations,
+	Memory,
+	Cancelled
+};
+
+const char *to_string(StopReason reason) noexcept;
+
+
+/**
+ * @brief flag shared by copies, any of them cancels search of the others
+ * @note `cancel` is lock-free, so it may be called from signal handler
+ */
+class CancellationToken
+{
+	std::shared_ptr<std::atomic<bool>> cancelled_;
+public:
+	CancellationToken();
+
+	inline void cancel() const noexcept { cancelled_->store(true, std::memory_order_relaxed); }
+	inline bool cancelled() const noexcept { return cancelled_->load(std::memory_order_relaxed); }
+};
+
+
+// resources of one solve, UNLIMITED disables limit
+struct Limits
+{
+	std::uint64_t time_ms = 60000;
+	std::uint64_t derivations = UNLIMITED;
+	std::uint64_t memory_bytes = UNLIMITED;
+
+	// soft limit of memory, past it search spills new facts to disk instead of stopping
+	std::uint64_t memory_cap = UNLIMITED;
+};
+
+
+/**
+ * @brief monotonic deadline, budgets of derivations and memory and cancellation
+ *
+ * @note `stopped` polls clock, token and memory only every `period` calls,
+ * period adapts so that polls are 1-4 ms apart. Reason of the first stop is
+ * kept, every later call returns true at once. Memory probe is called by
+ * workers too, so it may only read solver state.
+ */
+class Governor
+{
+	using clock = std::chrono::steady_clock;
+
+	Limits limits_;
+	std::function<std::uint64_t()> memory_;
+	CancellationToken token_;
+
+	clock::time_point start_;
+	clock::time_point deadline_;
+
+	std::atomic<std::uint64_t> derivations_;
+	std::atomic<std::int64_t> countdown_;
+	std::atomic<std::int64_t> period_;
+	std::atomic<clock::rep> last_poll_;
+	std::atomic<StopReason> reason_;
+
+	// set reason if any limit is exceeded
+	StopReason poll();
+
+	// deadline of time limit counted from start
+	clock::time_point limit_deadline() const;
+	void stop(StopReason reason) noexcept;
+public:
+	explicit Governor(const Limits &limits = {});
+	Governor(const Governor &) = delete;
+	Governor &operator=(const Governor &) = delete;
+
+	void set_limits(const Limits &limits);
+	void set_memory_probe(std::function<std::uint64_t()> probe);
+	void set_token(CancellationToken token);
+
+	// deadline and budgets are counted from now
+	void start();
+
+	// deadline is at most `ms` from now
+	void shorten(std::uint64_t ms);
+
+	/**
+	 * @brief deadline of time limit is restored after `shorten`
+	 * @note stop by deadline or by budget of derivations is cleared,
+	 * budget isn't reset, so only work which isn't charged goes on
+	 */
+	void resume();
+
+	inline void charge(std::uint64_t derivations = 1) noexcept
+	{
+		if (derivations_.fetch_add(derivations, std::memory_order_relaxed) + derivations > limits_.derivations)
+		{
+			stop(StopReason::Derivations);
+		}
+	}
+
+	// amortized check which is cheap enough for hot loops, safe for workers
+	inline bool stopped()
+	{
+		if (reason_.load(std::memory_order_relaxed) != StopReason::None)
+		{
+			return true;
+		}
+
+		if (countdown_.fetch_sub(1, std::memory_order_relaxed) > 1)
+		{
+			return false;
+		}
+
+		return poll() != StopReason::None;
+	}
+
+	// check of every limit at once
+	bool check();
+
+	inline StopReason reason() const noexcept { return reason_.load(std::memory_order_relaxed); }
+	inline std::uint64_t derivations() const noexcept { return derivations_.load(std::memory_order_relaxed); }
+	std::uint64_t elapsed_ms() const;
+};
+
+#endif // GOVERNOR_HPP
@@ -0,0 +1,480 @@
+#include <map>
+#include <stack>
+#include <functional>
+#include <unordered_map>
+#include "kalmar.hpp"
+#include "derivation.hpp"
+#include "../math/tautology.hpp"
+
+
+namespace
+{
+
+constexpr const std::size_t NO_LINE = static_cast<std::size_t>(-1);
+
+// construction was stopped by caller
+struct Stopped {};
+
+
+struct Formulas
+{
+	TermStore &store;
+
+	inline term_id imp(term_id a, term_id b) { return store.function(operation_t::Implication, a, b); }
+	inline term_id conj(term_id a, term_id b) { return store.function(operation_t::Conjunction, a, b); }
+	inline term_id neg(term_id a) { return store.negation(a); }
+};
+
+
+// lemmas over arbitrary formulas, index of lemma in `d` is returned
+
+// !a > (a > b)
+std::size_t explosion(Derivation &d, term_id a, term_id b)
+{
+	Formulas f{d.store()};
+	Derivation s(d.store());
+
+	const auto not_a = s.hypothesis(f.neg(a));
+	const auto is_a = s.hypothesis(a);
+	const auto first = s.mp(not_a, s.axiom(0, f.neg(a), f.neg(b)));
+	const auto second = s.mp(is_a, s.axiom(0, a, f.neg(b)));
+	s.mp(second, s.mp(first, s.axiom(2, b, a)));
+
+	return d.append(s.discharge(a).discharge(f.neg(a)));
+}
+
+
+// (a > b) > (!b > !a)
+std::size_t contraposition(Derivation &d, term_id a, term_id b)
+{
+	Formulas f{d.store()};
+	Derivation s(d.store());
+
+	const auto implication = s.hypothesis(f.imp(a, b));
+	const auto not_b = s.hypothesis(f.neg(b));
+	const auto a_not_b = s.mp(not_b, s.axiom(0, f.neg(b), a));
+	s.mp(implication, s.mp(a_not_b, s.axiom(2, f.neg(a), b)));
+
+	return d.append(s.discharge(f.neg(b)).discharge(f.imp(a, b)));
+}
+
+
+// a > (!b > (a * !b)), i.e. a, !b ⊢ !(a > b)
+std::size_t conjunction(Derivation &d, term_id a, term_id b)
+{
+	Formulas f{d.store()};
+	Derivation s(d.store());
+	const auto m = f.imp(a, b);
+
+	s.hypothesis(a);
+	s.hypothesis(f.neg(b));
+	s.mp(s.line(a), s.hypothesis(m));
+	s = s.discharge(m);
+	const auto m_b = s.goal();
+
+	const auto m_not_b = s.mp(s.line(f.neg(b)), s.axiom(0, f.neg(b), m));
+	s.mp(m_b, s.mp(m_not_b, s.axiom(2, f.neg(m), b)));
+
+	return d.append(s.discharge(f.neg(b)).discharge(a));
+}
+
+
+// (a * b) > a
+std::size_t left_projection(Derivation &d, term_id a, term_id b)
+{
+	Formulas f{d.store()};
+	Derivation s(d.store());
+	const auto c = f.conj(a, b);
+
+	const auto is_c = s.hypothesis(c);
+	const auto not_a_not_c = explosion(s, a, f.neg(b));
+	const auto not_a_c = s.mp(is_c, s.axiom(0, c, f.neg(a)));
+	s.mp(not_a_c, s.mp(not_a_not_c, s.axiom(2, a, c)));
+
+	return d.append(s.discharge(c));
+}
+
+
+// (a * b) > b
+std::size_t right_projection(Derivation &d, term_id a, term_id b)
+{
+	Formulas f{d.store()};
+	Derivation s(d.store());
+	const auto c = f.conj(a, b);
+
+	const auto is_c = s.hypothesis(c);
+	const auto not_b_not_c = s.axiom(0, f.neg(b), a);
+	const auto not_b_c = s.mp(is_c, s.axiom(0, c, f.neg(b)));
+	s.mp(not_b_c, s.mp(not_b_not_c, s.axiom(2, b, c)));
+
+	return d.append(s.discharge(c));
+}
+
+
+// (a > c) > ((!a > c) > c)
+std::size_t cases(Derivation &d, term_id a, term_id c)
+{
+	Formulas f{d.store()};
+	Derivation s(d.store());
+
+	const auto positive = s.hypothesis(f.imp(a, c));
+	const auto negative = s.hypothesis(f.imp(f.neg(a), c));
+	const auto not_c_not_a = s.mp(positive, contraposition(s, a, c));
+	const auto not_c_a = s.mp(negative, contraposition(s, f.neg(a), c));
+	s.mp(not_c_a, s.mp(not_c_not_a, s.axiom(2, c, a)));
+
+	return d.append(s.discharge(f.imp(f.neg(a), c)).discharge(f.imp(a, c)));
+}
+
+
+// ((a * b) > c) > (((a * !b) > c) > (a > c))
+std::size_t context_cases(Derivation &d, term_id a, term_id b, term_id c)
+{
+	Formulas f{d.store()};
+	Derivation s(d.store());
+
+	const auto positive = f.imp(f.conj(a, b), c);
+	const auto negative = f.imp(f.conj(a, f.neg(b)), c);
+
+	s.hypothesis(positive);
+	s.hypothesis(negative);
+	s.hypothesis(a);
+
+	// b ⊢ a * b ⊢ c
+	s.hypothesis(b);
+	s.mp(s.mp(s.line(b), s.mp(s.line(a), conjunction(s, a, f.neg(b)))), s.line(positive));
+	s = s.discharge(b);
+
+	// !b ⊢ a * !b ⊢ c
+	s.hypothesis(f.neg(b));
+	s.mp(s.mp(s.line(f.neg(b)), s.mp(s.line(a), conjunction(s, a, b))), s.line(negative));
+	s = s.discharge(f.neg(b));
+
+	const auto split = cases(s, b, c);
+	s.mp(s.line(f.imp(f.neg(b), c)), s.mp(s.line(f.imp(b, c)), split));
+
+	return d.append(s.discharge(a).discharge(negative).discharge(positive));
+}
+
+
+/**
+ * @brief lines of schemas cited by Kalmár proof, lifted lemma P > Q
+ * is (C > P) > (C > Q), so it's applied in context C by one mp
+ */
+struct Library
+{
+	std::size_t distribution;
+	std::size_t identity;
+	std::size_t left_projection;
+	std::size_t right_projection;
+	std::size_t cases;
+	std::size_t context_cases;
+
+	std::size_t lifted_weakening;
+	std::size_t lifted_explosion;
+	std::size_t lifted_conjunction;
+	std::size_t lifted_left_projection;
+	std::size_t lifted_right_projection;
+};
+
+
+Library library(Derivation &proof)
+{
+	auto &store = proof.store();
+
+	// lemmas are derived over constants, their lines are valid for any formulas
+	const term_id a = store.leaf(Term(term_t::Constant, operation_t::Nop, 1));
+	const term_id b = store.leaf(Term(term_t::Constant, operation_t::Nop, 2));
+	const term_id c = store.leaf(Term(term_t::Constant, operation_t::Nop, 3));
+
+	auto schema = [&] (auto lemma)
+	{
+		Derivation scratch(store);
+		lemma(scratch);
+		return proof.append(scratch, true);
+	};
+
+	Library lib;
+	const auto weakening = proof.axiom(0);
+	lib.distribution = proof.axiom(1);
+
+	auto lift = [&] (std::size_t lemma)
+	{
+		return proof.mp(proof.mp(lemma, weakening), lib.distribution);
+	};
+
+	lib.identity = schema([&] (Derivation &d) { d.identity(a); });
+	lib.left_projection = schema([&] (Derivation &d) { left_projection(d, a, b); });
+	lib.right_projection = schema([&] (Derivation &d) { right_projection(d, a, b); });
+	lib.cases = schema([&] (Derivation &d) { cases(d, a, c); });
+	lib.context_cases = schema([&] (Derivation &d) { context_cases(d, a, b, c); });
+
+	lib.lifted_weakening = lift(weakening);
+	lib.lifted_explosion = lift(schema([&] (Derivation &d) { explosion(d, a, b); }));
+	lib.lifted_conjunction = lift(schema([&] (Derivation &d) { conjunction(d, a, b); }));
+	lib.lifted_left_projection = lift(lib.left_projection);
+	lib.lifted_right_projection = lift(lib.right_projection);
+
+	return lib;
+}
+
+}
+
+
+bool kalmar_supported(const TermStore &store, term_id target, std::size_t max_atoms)
+{
+	if (target == INVALID_TERM)
+	{
+		return false;
+	}
+
+	std::map<std::pair<term_t, value_t>, std::size_t> atoms;
+	std::stack<term_id> s;
+	s.push(target);
+
+	while (!s.empty())
+	{
+		const auto current = s.top();
+		s.pop();
+
+		const auto &term = store.term(current);
+		if (term.type != term_t::Function)
+		{
+			atoms.try_emplace({term.type, term.value}, atoms.size());
+			continue;
+		}
+
+		if (term.op != operation_t::Implication && term.op != operation_t::Conjunction)
+		{
+			return false;
+		}
+
+		s.push(store.left(current));
+		s.push(store.right(current));
+	}
+
+	return atoms.size() <= max_atoms;
+}
+
+
+std::optional<std::string> kalmar_proof(
+	TermStore &store,
+	term_id target,
+	std::size_t max_atoms,
+	const std::function<bool()> &stopped
+)
+{
+	if (!kalmar_supported(store, target, max_atoms) || counterexample(store.expression(target)))
+	{
+		return std::nullopt;
+	}
+
+	Formulas f{store};
+
+	// atoms in order of their values, positive literal of each one
+	std::map<std::pair<term_t, value_t>, std::size_t> index;
+	std::stack<term_id> s;
+	s.push(target);
+
+	while (!s.empty())
+	{
+		const auto current = s.top();
+		s.pop();
+
+		const auto &term = store.term(current);
+		if (term.type == term_t::Function)
+		{
+			s.push(store.left(current));
+			s.push(store.right(current));
+			continue;
+		}
+
+		index.try_emplace({term.type, term.value}, 0);
+	}
+
+	std::vector<term_id> atoms;
+	for (auto &[key, idx] : index)
+	{
+		idx = atoms.size();
+		atoms.push_back(store.leaf(Term(key.first, operation_t::Nop, key.second)));
+	}
+
+	const auto n = atoms.size();
+	std::vector<bool> values(n);
+
+	auto literal = [&] (std::size_t k)
+	{
+		return values[k] ? atoms[k] : f.neg(atoms[k]);
+	};
+
+	auto poll = [&]
+	{
+		if (stopped && stopped())
+		{
+			throw Stopped{};
+		}
+	};
+
+	Derivation proof(store);
+	const auto lib = library(proof);
+
+	// Π ⊢ node' for context Π of the whole assignment, where node' is
+	// node if it's true and its negation otherwise
+	std::unordered_map<term_id, bool> truth;
+	std::unordered_map<term_id, std::size_t> proved;
+	std::vector<std::size_t> projections(n);
+
+	std::function<bool(term_id)> evaluate = [&] (term_id node)
+	{
+		if (const auto it = truth.find(node); it != truth.end())
+		{
+			return it->second;
+		}
+
+		const auto &term = store.term(node);
+		bool value = false;
+
+		if (term.type != term_t::Function)
+		{
+			value = values[index.at({term.type, term.value})] != (term.op == operation_t::Negation);
+		}
+		else if (term.op == operation_t::Implication)
+		{
+			value = !evaluate(store.left(node)) || evaluate(store.right(node));
+		}
+		else
+		{
+			value = evaluate(store.left(node)) && evaluate(store.right(node));
+		}
+
+		truth.emplace(node, value);
+		return value;
+	};
+
+	std::function<std::size_t(term_id, term_id)> prove = [&] (term_id context, term_id node)
+	{
+		if (const auto it = proved.find(node); it != proved.end())
+		{
+			return it->second;
+		}
+
+		poll();
+
+		// store grows while node is proved, so term is copied
+		const auto term = store.term(node);
+		std::size_t line = NO_LINE;
+
+		if (term.type != term_t::Function)
+		{
+			// literal of node is literal of its atom
+			line = projections[index.at({term.type, term.value})];
+		}
+		else
+		{
+			// conjunction x * y is !(x > !y)
+			const auto x = store.left(node);
+			const auto y = term.op == operation_t::Implication ? store.right(node) : f.neg(store.right(node));
+			const auto m = f.imp(x, y);
+			const bool y_value = evaluate(store.right(node)) == (term.op == operation_t::Implication);
+
+			if (!evaluate(x))
+			{
+				line = proof.mp(prove(context, x), lib.lifted_explosion, f.imp(context, m));
+			}
+			else if (y_value)
+			{
+				line = proof.mp(prove(context, store.right(node)), lib.lifted_weakening, f.imp(context, m));
+			}
+			else
+			{
+				// x, !y ⊢ !(x > y)
+				const auto not_m = f.neg(m);
+				const auto step = proof.mp(prove(context, x), lib.lifted_conjunction, f.imp(context, f.imp(f.neg(y), not_m)));
+				const auto distributed = proof.mp(step, lib.distribution,
+					f.imp(f.imp(context, f.neg(y)), f.imp(context, not_m)));
+				line = proof.mp(prove(context, store.right(node)), distributed, f.imp(context, not_m));
+			}
+		}
+
+		proved.emplace(node, line);
+		return line;
+	};
+
+	// Π ⊢ target for assignment of all atoms, Π = ((l1 * l2) * ...) * ln
+	auto prove_assignment = [&] (term_id context)
+	{
+		poll();
+		truth.clear();
+		proved.clear();
+
+		if (n == 1)
+		{
+			projections[0] = lib.identity;
+		}
+		else
+		{
+			// Π ⊢ Π_k for shorter prefixes of context, the literal of each prefix is projected
+			std::vector<term_id> prefixes(n);
+			prefixes[0] = literal(0);
+			for (std::size_t k = 1; k < n; ++k)
+			{
+				prefixes[k] = f.conj(prefixes[k - 1], literal(k));
+			}
+
+			projections[n - 1] = lib.right_projection;
+			auto prefix = lib.left_projection;
+
+			for (std::size_t k = n - 1; k-- > 0;)
+			{
+				if (k == 0)
+				{
+					projections[0] = prefix;
+					break;
+				}
+
+				projections[k] = proof.mp(prefix, lib.lifted_right_projection, f.imp(context, literal(k)));
+				prefix = proof.mp(prefix, lib.lifted_left_projection, f.imp(context, prefixes[k - 1]));
+			}
+		}
+
+		return prove(context, target);
+	};
+
+	// Π_k ⊢ target by both values of the next atom, Π_0 is empty
+	std::function<std::size_t(std::size_t, term_id)> eliminate = [&] (std::size_t k, term_id context)
+	{
+		if (k == n)
+		{
+			return prove_assignment(context);
+		}
+
+		std::size_t lines[2];
+		for (const bool value : {true, false})
+		{
+			values[k] = value;
+			lines[value] = eliminate(k + 1, k == 0 ? literal(k) : f.conj(context, literal(k)));
+		}
+
+		const auto atom = atoms[k];
+		if (k == 0)
+		{
+			const auto step = proof.mp(lines[1], lib.cases, f.imp(f.imp(f.neg(atom), target), target));
+			return proof.mp(lines[0], step, target);
+		}
+
+		const auto step = proof.mp(lines[1], lib.context_cases,
+			f.imp(f.imp(f.conj(context, f.neg(atom)), target), f.imp(context, target)));
+		return proof.mp(lines[0], step, f.imp(context, target));
+	};
+
+	try
+	{
+		eliminate(0, INVALID_TERM);
+	}
+	catch (const Stopped &)
+	{
+		return std::nullopt;
+	}
+
+	return proof.to_string();
+}
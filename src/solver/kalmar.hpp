@@ -0,0 +1,38 @@
+#ifndef KALMAR_HPP
+#define KALMAR_HPP
+
+#include <optional>
+#include <functional>
+#include <string>
+#include "../math/ast.hpp"
+#include "../math/term_store.hpp"
+
+
+/**
+ * @brief can target be proved by Kalmár construction?
+ * @note only implications, conjunctions and negations of atoms are supported,
+ * standardized disjunctions are implications
+ */
+bool kalmar_supported(const TermStore &store, term_id target, std::size_t max_atoms);
+
+
+/**
+ * @brief Hilbert proof of tautology built by Kalmár's lemma
+ *
+ * @note for every assignment of n atoms target is proved in context of
+ * conjunction of their literals, contexts of both values of the last atom are
+ * merged until no atom is left. Lemmas are derived once from axioms by deduction
+ * theorem of derivation.hpp and cited as schemas, so proof has O(2^n (n + size of target)) lines.
+ * Returns thought chain of `N. axiom: f` and `N. mp(i,j): f` lines,
+ * std::nullopt if target isn't supported or isn't a tautology.
+ * `stopped` is polled for every assignment and every subformula proved in it,
+ * construction gives up with std::nullopt once it returns true
+ */
+std::optional<std::string> kalmar_proof(
+	TermStore &store,
+	term_id target,
+	std::size_t max_atoms,
+	const std::function<bool()> &stopped = {}
+);
+
+#endif // KALMAR_HPP
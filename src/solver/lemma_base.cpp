@@ -0,0 +1,61 @@
+#include <mutex>
+#include "lemma_base.hpp"
+
+
+std::size_t LemmaBase::add(
+	Expression expression,
+	std::string rule,
+	std::vector<std::size_t> dependencies
+)
+{
+	expression.normalize();
+	const auto hash = expression.hash();
+
+	std::unique_lock lock(mutex_);
+
+	auto [begin, end] = index_.equal_range(hash);
+	for (auto it = begin; it != end; ++it)
+	{
+		if (lemmas_[it->second].expression.equals(expression, false))
+		{
+			return it->second;
+		}
+	}
+
+	const auto idx = lemmas_.size();
+	lemmas_.push_back({std::move(expression), std::move(rule), std::move(dependencies)});
+	index_.emplace(hash, idx);
+	return idx;
+}
+
+
+void LemmaBase::merge(const std::vector<Lemma> &lemmas)
+{
+	std::vector<std::size_t> indices;
+	indices.reserve(lemmas.size());
+
+	for (const auto &lemma : lemmas)
+	{
+		std::vector<std::size_t> dependencies;
+		for (const auto &dependency : lemma.dependencies)
+		{
+			dependencies.push_back(indices[dependency]);
+		}
+
+		indices.push_back(add(lemma.expression, lemma.rule, std::move(dependencies)));
+	}
+}
+
+
+std::vector<Lemma> LemmaBase::snapshot() const
+{
+	std::shared_lock lock(mutex_);
+	return lemmas_;
+}
+
+
+std::size_t LemmaBase::size() const
+{
+	std::shared_lock lock(mutex_);
+	return lemmas_.size();
+}
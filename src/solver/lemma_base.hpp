@@ -0,0 +1,57 @@
+#ifndef LEMMA_BASE_HPP
+#define LEMMA_BASE_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <shared_mutex>
+#include <unordered_map>
+#include "../math/ast.hpp"
+
+
+/**
+ * @brief lemma valid without hypotheses together with its derivation
+ * @note dependencies are indices of other lemmas of the same base
+ */
+struct Lemma
+{
+	Expression expression;
+	std::string rule;
+	std::vector<std::size_t> dependencies;
+};
+
+
+/**
+ * @brief concurrent collection of lemmas shared by solvers of a batch
+ *
+ * @note lemmas are only appended, dependencies of lemma are always
+ * added before it, so every prefix of the base is closed under derivations
+ */
+class LemmaBase
+{
+	mutable std::shared_mutex mutex_;
+	std::vector<Lemma> lemmas_;
+
+	// canonical hash of normalized expression to indices of lemmas
+	std::unordered_multimap<std::uint64_t, std::size_t> index_;
+public:
+	LemmaBase() = default;
+	LemmaBase(const LemmaBase &) = delete;
+	LemmaBase &operator=(const LemmaBase &) = delete;
+
+	/**
+	 * @brief add lemma if it's not known yet
+	 * @note `expression` is normalized, returns index of lemma in the base
+	 */
+	std::size_t add(Expression expression, std::string rule, std::vector<std::size_t> dependencies);
+
+	// add lemmas of other collection, dependencies are remapped to this base
+	void merge(const std::vector<Lemma> &lemmas);
+
+	// copy of lemmas added so far
+	std::vector<Lemma> snapshot() const;
+
+	std::size_t size() const;
+};
+
+#endif // LEMMA_BASE_HPP
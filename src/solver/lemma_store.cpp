@@ -0,0 +1,383 @@
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <filesystem>
+#include <unordered_map>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "lemma_store.hpp"
+
+
+namespace
+{
+	constexpr const char MAGIC[8] = {'P', 'C', 'L', 'E', 'M', 'M', 'A', '\0'};
+
+	template <typename T>
+	void write_array(std::ofstream &out, const std::vector<T> &values)
+	{
+		out.write(reinterpret_cast<const char *>(values.data()), values.size() * sizeof(T));
+	}
+}
+
+
+Expression LemmaStore::generalized(const Expression &expression)
+{
+	// leaves are renamed in order of first occurrence regardless of their type
+	std::unordered_map<std::uint64_t, value_t> remapping;
+	std::vector<Term> preorder;
+	preorder.reserve(expression.size());
+
+	for (std::size_t i = 0; i < expression.size(); ++i)
+	{
+		auto term = expression[i];
+		if (term.type == term_t::Constant || term.type == term_t::Variable)
+		{
+			const auto key = static_cast<std::uint64_t>(term.type) << 32 |
+				static_cast<std::uint32_t>(term.value);
+			const auto value = static_cast<value_t>(remapping.size()) + 1;
+
+			term.type = term_t::Variable;
+			term.value = remapping.try_emplace(key, value).first->second;
+		}
+
+		preorder.push_back(term);
+	}
+
+	return Expression(preorder);
+}
+
+
+LemmaStore::LemmaStore(const std::string &path)
+	: data_(nullptr)
+	, size_(0)
+	, header_(nullptr)
+	, records_(nullptr)
+	, nodes_(nullptr)
+	, dependencies_(nullptr)
+	, buckets_(nullptr)
+	, rules_(nullptr)
+{
+	const int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		throw std::invalid_argument("[-] error: can't open lemma store " + path);
+	}
+
+	struct stat info;
+	if (::fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(Header))
+	{
+		::close(fd);
+		throw std::invalid_argument("[-] error: lemma store " + path + " is truncated");
+	}
+
+	size_ = static_cast<std::size_t>(info.st_size);
+	void *data = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+
+	if (data == MAP_FAILED)
+	{
+		throw std::invalid_argument("[-] error: can't map lemma store " + path);
+	}
+
+	// lookups jump over the file, so readahead is useless
+	::madvise(data, size_, MADV_RANDOM);
+	data_ = static_cast<const std::uint8_t *>(data);
+	header_ = reinterpret_cast<const Header *>(data_);
+
+	const auto &h = *header_;
+	const bool valid_header = std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) == 0 &&
+		h.version == VERSION &&
+		h.byte_order == ENDIANNESS_MARK &&
+		(h.buckets & (h.buckets - 1)) == 0 &&
+		h.buckets > h.lemmas;
+
+	// sizes are checked one by one, so their sum can't overflow
+	std::size_t offset = sizeof(Header);
+	auto section = [&] (std::uint64_t count, std::size_t size) -> const std::uint8_t *
+	{
+		if (count > (size_ - offset) / size)
+		{
+			return nullptr;
+		}
+
+		const auto *begin = data_ + offset;
+		offset += count * size;
+		return begin;
+	};
+
+	const std::uint8_t *records = nullptr;
+	const std::uint8_t *nodes = nullptr;
+	const std::uint8_t *dependencies = nullptr;
+	const std::uint8_t *buckets = nullptr;
+	const std::uint8_t *rules = nullptr;
+
+	// every bucket names a lemma and some bucket is empty, so probing stops
+	auto valid_buckets = [&]
+	{
+		const auto *begin = reinterpret_cast<const std::uint32_t *>(buckets);
+		std::uint64_t used = 0;
+
+		for (const auto *bucket = begin; bucket != begin + h.buckets; ++bucket)
+		{
+			if (*bucket > h.lemmas)
+			{
+				return false;
+			}
+			used += *bucket != 0 ? 1 : 0;
+		}
+
+		return used <= h.lemmas;
+	};
+
+	if (!valid_header ||
+		!(records = section(h.lemmas, sizeof(Record))) ||
+		!(nodes = section(h.nodes, sizeof(StoredNode))) ||
+		!(dependencies = section(h.dependencies, sizeof(std::uint32_t))) ||
+		!(buckets = section(h.buckets, sizeof(std::uint32_t))) ||
+		!(rules = section(h.rules, sizeof(char))) ||
+		offset != size_ ||
+		h.rules == 0 || rules[h.rules - 1] != '\0' ||
+		!valid_buckets())
+	{
+		::munmap(data, size_);
+		throw std::invalid_argument("[-] error: " + path + " is not a lemma store of version " +
+			std::to_string(VERSION));
+	}
+
+	records_ = reinterpret_cast<const Record *>(records);
+	nodes_ = reinterpret_cast<const StoredNode *>(nodes);
+	dependencies_ = reinterpret_cast<const std::uint32_t *>(dependencies);
+	buckets_ = reinterpret_cast<const std::uint32_t *>(buckets);
+	rules_ = reinterpret_cast<const char *>(rules);
+}
+
+
+LemmaStore::~LemmaStore()
+{
+	::munmap(const_cast<std::uint8_t *>(data_), size_);
+}
+
+
+void LemmaStore::save(const std::string &path, const std::vector<Lemma> &lemmas)
+{
+	Header header{};
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.byte_order = ENDIANNESS_MARK;
+	header.lemmas = lemmas.size();
+
+	// load factor is kept at most 1/2
+	header.buckets = 1;
+	while (header.buckets <= 2 * lemmas.size())
+	{
+		header.buckets <<= 1;
+	}
+
+	std::vector<Record> records;
+	std::vector<StoredNode> nodes;
+	std::vector<std::uint32_t> dependencies;
+	std::vector<std::uint32_t> buckets(header.buckets, 0);
+	std::string rules;
+	std::unordered_map<std::string, std::uint32_t> rule_offsets;
+
+	for (std::size_t i = 0; i < lemmas.size(); ++i)
+	{
+		const auto &lemma = lemmas[i];
+		const auto expression = generalized(lemma.expression);
+
+		auto [rule, inserted] = rule_offsets.try_emplace(lemma.rule, rules.size());
+		if (inserted)
+		{
+			rules += lemma.rule;
+			rules += '\0';
+		}
+
+		Record record{};
+		record.key = expression.hash();
+		record.first_node = static_cast<std::uint32_t>(nodes.size());
+		record.nodes = static_cast<std::uint32_t>(expression.size());
+		record.first_dependency = static_cast<std::uint32_t>(dependencies.size());
+		record.dependencies = static_cast<std::uint32_t>(lemma.dependencies.size());
+		record.rule = rule->second;
+		records.push_back(record);
+
+		for (std::size_t j = 0; j < expression.size(); ++j)
+		{
+			const auto term = expression[j];
+			nodes.push_back({term.value, pack_tag(term.type, term.op), {}});
+		}
+
+		for (const auto &dependency : lemma.dependencies)
+		{
+			if (dependency >= i)
+			{
+				throw std::invalid_argument("[-] error: lemma depends on later one");
+			}
+
+			dependencies.push_back(static_cast<std::uint32_t>(dependency));
+		}
+
+		// linear probing
+		auto bucket = record.key & (header.buckets - 1);
+		while (buckets[bucket] != 0)
+		{
+			bucket = (bucket + 1) & (header.buckets - 1);
+		}
+		buckets[bucket] = static_cast<std::uint32_t>(i + 1);
+	}
+
+	if (rules.empty())
+	{
+		rules += '\0';
+	}
+
+	header.nodes = nodes.size();
+	header.dependencies = dependencies.size();
+	header.rules = rules.size();
+
+	// readers of the old file keep their mapping, concurrent writers use their own files
+	std::string tmp = path + ".XXXXXX";
+	const int fd = ::mkstemp(tmp.data());
+	if (fd < 0)
+	{
+		throw std::invalid_argument("[-] error: can't create temporary file for lemma store " + path);
+	}
+
+	// mkstemp creates file readable only by owner
+	::fchmod(fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+	::close(fd);
+
+	{
+		std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+		out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		write_array(out, records);
+		write_array(out, nodes);
+		write_array(out, dependencies);
+		write_array(out, buckets);
+		out.write(rules.data(), rules.size());
+		out.close();
+
+		if (!out)
+		{
+			std::filesystem::remove(tmp);
+			throw std::invalid_argument("[-] error: can't write lemma store " + tmp);
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tmp, path, error);
+	if (error)
+	{
+		std::filesystem::remove(tmp);
+		throw std::invalid_argument("[-] error: can't replace lemma store " + path + ": " + error.message());
+	}
+}
+
+
+Expression LemmaStore::expression(const Record &record) const
+{
+	// records are checked when they are read, so only touched pages are read
+	if (record.first_node > header_->nodes || record.nodes > header_->nodes - record.first_node)
+	{
+		throw std::invalid_argument("[-] error: lemma store is corrupted");
+	}
+
+	std::vector<Term> preorder;
+	preorder.reserve(record.nodes);
+
+	// number of subtrees still expected, every function expects two more
+	std::size_t pending = 1;
+
+	for (std::size_t i = 0; i < record.nodes; ++i)
+	{
+		const auto &node = nodes_[record.first_node + i];
+		const auto type = tag_type(node.tag);
+
+		if (pending == 0 || type == term_t::None || type > term_t::Function)
+		{
+			throw std::invalid_argument("[-] error: lemma store is corrupted");
+		}
+
+		pending += type == term_t::Function ? 1 : -1;
+		preorder.emplace_back(type, tag_op(node.tag), node.value);
+	}
+
+	if (pending != 0)
+	{
+		throw std::invalid_argument("[-] error: lemma store is corrupted");
+	}
+
+	return Expression(preorder);
+}
+
+
+std::size_t LemmaStore::find(const Expression &target) const
+{
+	if (target.empty())
+	{
+		return npos;
+	}
+
+	const auto key = generalized(target);
+	const auto hash = key.hash();
+	const auto mask = header_->buckets - 1;
+
+	for (auto bucket = hash & mask; buckets_[bucket] != 0; bucket = (bucket + 1) & mask)
+	{
+		const auto idx = buckets_[bucket] - 1;
+		const auto &record = records_[idx];
+
+		if (record.key == hash && record.nodes == key.size() &&
+			expression(record).equals(key, false))
+		{
+			return idx;
+		}
+	}
+
+	return npos;
+}
+
+
+Lemma LemmaStore::lemma(std::size_t idx) const
+{
+	const auto &record = records_[idx];
+
+	if (record.rule >= header_->rules ||
+		record.first_dependency > header_->dependencies ||
+		record.dependencies > header_->dependencies - record.first_dependency)
+	{
+		throw std::invalid_argument("[-] error: lemma store is corrupted");
+	}
+
+	Lemma result{expression(record), rules_ + record.rule, {}};
+	result.dependencies.assign(
+		dependencies_ + record.first_dependency,
+		dependencies_ + record.first_dependency + record.dependencies
+	);
+
+	for (const auto &dependency : result.dependencies)
+	{
+		if (dependency >= idx)
+		{
+			throw std::invalid_argument("[-] error: lemma store is corrupted");
+		}
+	}
+
+	return result;
+}
+
+
+std::vector<Lemma> LemmaStore::lemmas() const
+{
+	std::vector<Lemma> result;
+	result.reserve(size());
+
+	for (std::size_t i = 0; i < size(); ++i)
+	{
+		result.push_back(lemma(i));
+	}
+
+	return result;
+}
@@ -0,0 +1,107 @@
+#ifndef LEMMA_STORE_HPP
+#define LEMMA_STORE_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../math/ast.hpp"
+#include "lemma_base.hpp"
+
+
+/**
+ * @brief read-only memory mapped file of lemmas with their derivations
+ *
+ * @note lemmas are looked up through hash table of the file, so opening
+ * touches only header and hash table, lookup only a few pages regardless of
+ * store size. The file is never modified in place: `save` writes a new file
+ * of unique name and renames it over the old one, so stores can be shared
+ * between processes.
+ */
+class LemmaStore
+{
+	// layout of file, every section directly follows the previous one
+	struct Header
+	{
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t byte_order;
+		std::uint64_t lemmas;
+		std::uint64_t nodes;
+		std::uint64_t dependencies;
+		std::uint64_t buckets;
+		std::uint64_t rules;
+	};
+	static_assert(sizeof(Header) == 56);
+
+	struct Record
+	{
+		// hash of generalized expression, see `key`
+		std::uint64_t key;
+		std::uint32_t first_node;
+		std::uint32_t nodes;
+		std::uint32_t first_dependency;
+		std::uint32_t dependencies;
+
+		// offset of rule name in rules section
+		std::uint32_t rule;
+		std::uint32_t reserved;
+	};
+	static_assert(sizeof(Record) == 32);
+
+	// term of preorder sequence
+	struct StoredNode
+	{
+		value_t value;
+		std::uint8_t tag;
+		std::uint8_t reserved[3];
+	};
+	static_assert(sizeof(StoredNode) == 8);
+
+	static constexpr std::uint32_t VERSION = 1;
+	static constexpr std::uint32_t ENDIANNESS_MARK = 0x01020304;
+
+	const std::uint8_t *data_;
+	std::size_t size_;
+
+	const Header *header_;
+	const Record *records_;
+	const StoredNode *nodes_;
+	const std::uint32_t *dependencies_;
+
+	// lemma index + 1 per bucket, 0 for empty bucket
+	const std::uint32_t *buckets_;
+	const char *rules_;
+
+	// expression with constants replaced by variables, normalized
+	static Expression generalized(const Expression &expression);
+
+	Expression expression(const Record &record) const;
+public:
+	static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+	explicit LemmaStore(const std::string &path);
+	LemmaStore(const LemmaStore &) = delete;
+	LemmaStore &operator=(const LemmaStore &) = delete;
+	~LemmaStore();
+
+	/**
+	 * @brief write lemmas to `path` atomically
+	 * @note dependencies of every lemma must precede it
+	 */
+	static void save(const std::string &path, const std::vector<Lemma> &lemmas);
+
+	inline std::size_t size() const noexcept { return header_->lemmas; }
+
+	/**
+	 * @brief index of lemma which `expression` is renaming of, npos if there is none
+	 * @note constants of `expression` are matched as variables
+	 */
+	std::size_t find(const Expression &expression) const;
+
+	Lemma lemma(std::size_t idx) const;
+
+	// every lemma of store, touches the whole file
+	std::vector<Lemma> lemmas() const;
+};
+
+#endif // LEMMA_STORE_HPP
@@ -0,0 +1,18 @@
+#include "lemma_table.hpp"
+
+
+namespace
+{
+
+// generated by `lemma-gen DEPTH SIZE STEPS` when solver is built
+constexpr const TableLemma LEMMAS[] = {
+#include "lemma_table.inc"
+};
+
+}
+
+
+std::span<const TableLemma> lemma_table()
+{
+	return LEMMAS;
+}
@@ -0,0 +1,36 @@
+#ifndef LEMMA_TABLE_HPP
+#define LEMMA_TABLE_HPP
+
+#include <span>
+#include <cstdint>
+
+
+constexpr const std::uint32_t NO_PREMISE = static_cast<std::uint32_t>(-1);
+
+
+/**
+ * @brief lemma of standard axioms derived offline by lemma-gen
+ * @note premises are indices of previous entries, axioms have none
+ */
+struct TableLemma
+{
+	const char *expression;
+	std::uint32_t premise;
+	std::uint32_t implication;
+
+	// lemma is a fact of search, other ones are only steps of derivations
+	bool fact;
+
+	// fact of the first generation, other facts are deferred to larger size bound
+	bool seed;
+};
+
+
+/**
+ * @brief lemmas generated at build time in order of derivation,
+ * the first ones are axioms of `hilbert_axioms`
+ * @note bounds of lemmas are set by LEMMA_DEPTH, LEMMA_SIZE and LEMMA_STEPS of Makefile
+ */
+std::span<const TableLemma> lemma_table();
+
+#endif // LEMMA_TABLE_HPP
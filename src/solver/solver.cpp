@@ -1,210 +1,1792 @@
 #include <queue>
 #include <ranges>
-#include <chrono>
 #include <iostream>
 #include <set>
-#include <queue>
+#include <stack>
+#include <atomic>
+#include <deque>
+#include <tuple>
+#include <array>
+#include <iterator>
 #include "solver.hpp"
+#include "candidate_set.hpp"
+#include "kalmar.hpp"
+#include "derivation.hpp"
+#include "lemma_table.hpp"
 #include "../math/helper.hpp"
 #include "../math/rules.hpp"
+#include "../math/tautology.hpp"
 
 
-std::uint64_t ms_since_epoch()
-{
-	return std::chrono::duration_cast<std::chrono::milliseconds>(
-		std::chrono::system_clock::now().time_since_epoch()
-	).count();
-}
+// parent of subgoals raised from targets
+constexpr const std::uint32_t NO_PARENT = static_cast<std::uint32_t>(-1);
+
+// spilled facts brought back at once when frontier runs out
+constexpr const std::size_t RESTORED_FACTS = 4096;
+
+// goals which backward chaining may try after one generation, over every depth
+constexpr const std::size_t BACKWARD_GOALS = 20000;
 
 
 Solver::Solver(std::vector<Expression> axioms,
 		Expression target,
-		std::uint64_t time_limit_ms
-) 	: known_axioms_()
-	, axioms_(std::move(axioms))
+		std::uint64_t time_limit_ms,
+		std::size_t threads
+) 	: store_()
+	, known_axioms_(0, CanonicalHash{&store_})
+	, axioms_()
 	, produced_()
+	, facts_()
+	, antecedents_()
+	, consequents_()
+	, retired_()
 	, targets_()
-	, time_limit_(time_limit_ms)
+	, target_expressions_()
+	, governor_(Limits{time_limit_ms, UNLIMITED, UNLIMITED, UNLIMITED})
+	, memory_cap_(UNLIMITED)
+	, spill_()
+	, chunk_(64)
+	, pool_(threads)
+	, arenas_()
+	, proofs_()
 	, ss{}
-	, dump_("conclusions.txt")
+	, dump_()
+	, lemma_base_(nullptr)
+	, lemma_store_(nullptr)
+	, hypotheses_()
+	, levels_()
+	, proof_(INVALID_TERM)
+	, backward_depth_(3)
+	, strategy_(Strategy::Bidirectional)
+	, forward_budget_(std::numeric_limits<std::size_t>::max())
+	, backward_budget_(4096)
+	, stats_()
+	, weight_(linear_weight(WeightConfig{}))
+	, age_ratio_(WeightConfig{}.age_ratio)
+	, depths_()
+	, subgoals_()
+	, subgoal_ids_()
+	, open_subgoals_()
+	, met_facts_(0)
+	, expanded_facts_(0)
+	, proved_goals_()
+	, failed_goals_()
+	, open_goals_()
+	, contexts_()
+	, deduction_(false)
+	, initial_size_(0)
+	, size_step_(4)
+	, max_size_(32)
+	, deferred_()
+	, rules_()
+	, kalmar_atoms_(10)
+	, kalmar_after_ms_(10000)
 {
-	if (axioms_.size() < 3)
+	if (axioms.size() < 3)
 	{
 		throw std::invalid_argument("[-] error: at least 3 axioms are required");
 	}
 
-	targets_.emplace_back(std::move(target));
+	for (const auto &axiom : axioms)
+	{
+		axioms_.push_back(store_.intern(axiom));
+	}
+
+	targets_.push_back(store_.intern(target));
 	axioms_.reserve(1000);
+
+	for (std::size_t i = 0; i < pool_.size(); ++i)
+	{
+		arenas_.push_back(std::make_unique<Arena>());
+	}
 	known_axioms_.reserve(10000);
 
-	// produce hack: implication swap rule (a->b) ~ (!b->!a)
-	axioms = {
-		Expression("a>(b>a)"),
-		Expression("(a>(b>c))>((a>b)>(a>c))"),
-		Expression("(!a>!b)>((!a>b)>a)")
+	governor_.set_memory_probe([this] { return memory_usage(); });
+}
+
+
+std::uint64_t Solver::memory_usage() const
+{
+	// node of hash table with its next pointer and cached hash, steps have about two dependencies
+	const auto step = sizeof(std::pair<const term_id, Node>) + 2 * sizeof(void *) + 32;
+	const auto depth = sizeof(std::pair<const term_id, std::size_t>) + 2 * sizeof(void *);
+	const auto known = sizeof(term_id) + 2 * sizeof(void *);
+
+	return store_.memory() +
+		proofs_.size() * step + proofs_.bucket_count() * sizeof(void *) +
+		depths_.size() * depth + depths_.bucket_count() * sizeof(void *) +
+		known_axioms_.size() * known + known_axioms_.bucket_count() * sizeof(void *) +
+		facts_.memory() + antecedents_.memory() + consequents_.memory() +
+		(axioms_.capacity() + produced_.capacity() + deferred_.capacity()) * sizeof(term_id) +
+		spill_.memory();
+}
+
+
+bool Solver::over_cap() const
+{
+	return memory_cap_ != UNLIMITED && memory_usage() > memory_cap_;
+}
+
+
+std::vector<term_id> Solver::restore(std::size_t count)
+{
+	std::vector<term_id> facts;
+	SpillQueue::Record spilled;
+
+	while (facts.size() < count && spill_.pop(spilled))
+	{
+		// fact may be derived again while it was on disk
+		const auto fact = store_.intern(spilled.expression);
+		if (!known_axioms_.insert(fact).second || is_subsumed(fact))
+		{
+			continue;
+		}
+
+		if (strategy_ == Strategy::GivenClause)
+		{
+			std::size_t depth = 0;
+			for (const auto &premise : spilled.premises)
+			{
+				depth = std::max(depth, depths_[premise]);
+			}
+			depths_[fact] = 1 + depth;
+		}
+
+		record(fact, rule_name(spilled.rule), spilled.premises);
+		facts.push_back(fact);
+	}
+
+	stats_.restored += facts.size();
+	return facts;
+}
+
+
+void Solver::record(term_id expression, std::string rule, std::vector<term_id> dependencies)
+{
+	auto [it, inserted] = proofs_.try_emplace(
+		expression,
+		Node{expression, std::move(rule), std::move(dependencies)}
+	);
+
+	if (!inserted)
+	{
+		return;
+	}
+
+	if (const auto depth = level(it->second.dependencies); depth != 0)
+	{
+		levels_.emplace(expression, depth);
+	}
+	governor_.charge();
+
+	if (!dump_)
+	{
+		return;
+	}
+
+	std::string line = store_.to_string(expression) + ' ' + it->second.rule;
+	for (const auto &dependency : it->second.dependencies)
+	{
+		line += ' ' + store_.to_string(dependency);
+	}
+
+	dump_->write(std::move(line));
+}
+
+
+void Solver::dump_to(const std::string &path)
+{
+	dump_ = std::make_unique<DumpSink>(path);
+
+	// derivations recorded before
+	for (const auto &[expression, node] : proofs_)
+	{
+		std::string line = store_.to_string(expression) + ' ' + node.rule;
+		for (const auto &dependency : node.dependencies)
+		{
+			line += ' ' + store_.to_string(dependency);
+		}
+
+		dump_->write(std::move(line));
+	}
+}
+
+
+void Solver::share_lemmas(LemmaBase &base)
+{
+	lemma_base_ = &base;
+}
+
+
+void Solver::use_store(const LemmaStore &store)
+{
+	lemma_store_ = &store;
+}
+
+
+void Solver::set_backward_depth(std::size_t depth)
+{
+	backward_depth_ = depth;
+}
+
+
+void Solver::set_strategy(Strategy strategy)
+{
+	strategy_ = strategy;
+}
+
+
+void Solver::set_budgets(std::size_t forward, std::size_t backward)
+{
+	forward_budget_ = std::max<std::size_t>(forward, 1);
+	backward_budget_ = backward;
+}
+
+
+void Solver::set_weight(weight_function weight, std::size_t age_ratio)
+{
+	weight_ = std::move(weight);
+	age_ratio_ = age_ratio;
+}
+
+
+void Solver::set_size_bounds(std::size_t initial, std::size_t step, std::size_t max)
+{
+	if (step == 0 || max == 0 || initial > max)
+	{
+		throw std::invalid_argument("[-] error: invalid size bounds");
+	}
+
+	initial_size_ = initial;
+	size_step_ = step;
+	max_size_ = max;
+}
+
+
+void Solver::set_rules(const std::vector<Rule> &rules)
+{
+	std::vector<Rule> derived;
+	std::ranges::copy_if(rules, std::back_inserter(derived), [] (const Rule &rule) {
+		return rule.name != "mp";
+	});
+
+	rules_ = RuleSet(store_, derived);
+}
+
+
+void Solver::set_kalmar(std::size_t max_atoms, std::uint64_t search_ms)
+{
+	kalmar_atoms_ = max_atoms;
+	kalmar_after_ms_ = search_ms;
+}
+
+
+void Solver::set_limits(const Limits &limits)
+{
+	governor_.set_limits(limits);
+	memory_cap_ = limits.memory_cap;
+}
+
+
+void Solver::set_cancellation(CancellationToken token)
+{
+	governor_.set_token(std::move(token));
+}
+
+
+void Solver::configure(const SolverOptions &options)
+{
+	set_strategy(options.strategy);
+	set_backward_depth(options.backward_depth);
+	set_budgets(options.forward_budget, options.backward_budget);
+	set_weight(linear_weight(options.weights), options.weights.age_ratio);
+	set_size_bounds(options.initial_size, options.size_step, options.max_size);
+	set_rules(options.rules);
+	set_kalmar(options.kalmar_atoms, options.kalmar_after_ms);
+	set_limits(options.limits);
+}
+
+
+void Solver::import_table(std::size_t max_len)
+{
+	std::vector<term_id> ids;
+	ids.reserve(lemma_table().size());
+
+	for (const auto &lemma : lemma_table())
+	{
+		const auto id = store_.normalize(store_.intern(Expression(lemma.expression)));
+		ids.push_back(id);
+
+		// axioms are recorded already
+		if (lemma.premise == NO_PREMISE)
+		{
+			continue;
+		}
+
+		record(id, "mp", {ids[lemma.premise], ids[lemma.implication]});
+
+		// seeds start search, other facts wait for the next size bound
+		if (lemma.seed)
+		{
+			produced_.push_back(id);
+		}
+		else if (lemma.fact && store_.size(id) <= max_len)
+		{
+			deferred_.push_back(id);
+		}
+	}
+}
+
+
+void Solver::import_lemmas(std::size_t max_len)
+{
+	if (lemma_base_ == nullptr)
+	{
+		return;
+	}
+
+	const auto lemmas = lemma_base_->snapshot();
+	std::vector<term_id> ids;
+	ids.reserve(lemmas.size());
+
+	for (const auto &lemma : lemmas)
+	{
+		const auto id = store_.intern(lemma.expression);
+		ids.push_back(id);
+
+		std::vector<term_id> dependencies;
+		for (const auto &dependency : lemma.dependencies)
+		{
+			dependencies.push_back(ids[dependency]);
+		}
+
+		// derivation is kept, so proof chain is complete
+		record(id, lemma.rule, std::move(dependencies));
+
+		if (lemma.rule != "axiom" && store_.size(id) <= max_len &&
+			std::ranges::find(produced_, id) == produced_.end())
+		{
+			produced_.push_back(id);
+		}
+	}
+}
+
+
+void Solver::publish_lemmas(term_id proof)
+{
+	if (lemma_base_ == nullptr)
+	{
+		return;
+	}
+
+	// fact is valid without hypotheses if all of its dependencies are
+	std::unordered_map<term_id, std::size_t> indices;
+
+	for (const auto &expression : proof_order(proof))
+	{
+		if (hypotheses_.contains(expression))
+		{
+			continue;
+		}
+
+		auto it = proofs_.find(expression);
+		const bool is_axiom = it == proofs_.end() || it->second.rule == "axiom";
+
+		std::vector<std::size_t> dependencies;
+		bool depends_on_hypotheses = false;
+
+		if (!is_axiom)
+		{
+			for (const auto &dependency : it->second.dependencies)
+			{
+				auto dep = indices.find(dependency);
+				if (dep == indices.end())
+				{
+					depends_on_hypotheses = true;
+					break;
+				}
+
+				dependencies.push_back(dep->second);
+			}
+		}
+
+		if (depends_on_hypotheses)
+		{
+			continue;
+		}
+
+		indices[expression] = lemma_base_->add(
+			store_.expression(expression),
+			is_axiom ? "axiom" : it->second.rule,
+			std::move(dependencies)
+		);
+	}
+}
+
+
+term_id Solver::expand_stored(std::size_t lemma)
+{
+	// dependencies precede lemma, so required lemmas are expanded in order of indices
+	std::set<std::size_t> required;
+	std::vector<std::size_t> pending = {lemma};
+
+	while (!pending.empty())
+	{
+		const auto idx = pending.back();
+		pending.pop_back();
+
+		if (!required.insert(idx).second)
+		{
+			continue;
+		}
+
+		for (const auto &dependency : lemma_store_->lemma(idx).dependencies)
+		{
+			pending.push_back(dependency);
+		}
+	}
+
+	std::vector<std::pair<std::size_t, Lemma>> lemmas;
+	for (const auto &idx : required)
+	{
+		auto stored = lemma_store_->lemma(idx);
+
+		// store could be built from other axioms
+		if (stored.rule == "axiom")
+		{
+			auto it = proofs_.find(store_.intern(stored.expression));
+			if (it == proofs_.end() || it->second.rule != "axiom" || hypotheses_.contains(it->first))
+			{
+				return INVALID_TERM;
+			}
+		}
+
+		lemmas.emplace_back(idx, std::move(stored));
+	}
+
+	std::unordered_map<std::size_t, term_id> ids;
+	for (auto &[idx, stored] : lemmas)
+	{
+		const auto id = store_.intern(stored.expression);
+
+		std::vector<term_id> dependencies;
+		for (const auto &dependency : stored.dependencies)
+		{
+			dependencies.push_back(ids.at(dependency));
+		}
+
+		record(id, std::move(stored.rule), std::move(dependencies));
+		ids[idx] = id;
+	}
+
+	return ids.at(lemma);
+}
+
+
+term_id Solver::find_stored_proof(term_id &target_proved)
+{
+	if (lemma_store_ == nullptr)
+	{
+		return INVALID_TERM;
+	}
+
+	for (std::size_t i = 0; i < target_expressions_.size(); ++i)
+	{
+		// target is renaming of stored lemma with constants as variables
+		const auto lemma = lemma_store_->find(target_expressions_[i]);
+		if (lemma == LemmaStore::npos)
+		{
+			continue;
+		}
+
+		const auto proof = expand_stored(lemma);
+		if (proof != INVALID_TERM)
+		{
+			target_proved = targets_[i];
+			return proof;
+		}
+	}
+
+	return INVALID_TERM;
+}
+
+
+term_id Solver::prove_goal(term_id goal, std::size_t depth, std::size_t max_len, std::size_t &budget)
+{
+	goal = store_.normalize(goal);
+
+	if (const auto fact = proved_goal(goal); fact != INVALID_TERM)
+	{
+		return fact;
+	}
+
+	if (budget == 0 || store_.size(goal) > max_len || governor_.stopped())
+	{
+		return INVALID_TERM;
+	}
+	--budget;
+
+	// goal is an instance of known fact
+	std::vector<std::uint32_t> candidates;
+	facts_.retrieve_generalizations(store_, goal, candidates);
+	std::ranges::sort(candidates);
+
+	for (const auto &j : candidates)
+	{
+		if (!retired_[j] && matches(store_, axioms_[j], goal))
+		{
+			proved_goals_[goal] = axioms_[j];
+			return axioms_[j];
+		}
+	}
+
+	if (depth == 0 || open_goals_.contains(goal))
+	{
+		return INVALID_TERM;
+	}
+
+	// failure over knowledge base says nothing about goal under hypotheses
+	if (const auto &failed = contexts_.empty() ? failed_goals_ : contexts_.back().failed;
+		failed.contains(goal) && failed.at(goal) >= depth)
+	{
+		return INVALID_TERM;
+	}
+
+	// consequent is proved under antecedent, which takes a step like mp does
+	if (deduction_ && store_.term(goal).op == operation_t::Implication && store_.max_value(goal) == 0)
+	{
+		if (const auto fact = prove_by_deduction(goal, depth - 1, max_len, budget); fact != INVALID_TERM)
+		{
+			(contexts_.empty() ? proved_goals_ : contexts_.back().proved)[goal] = fact;
+			return fact;
+		}
+	}
+
+	// goal is an instance of consequent of implication, its antecedent is raised
+	// as subgoal, variables which are only in antecedent stay free
+	open_goals_.insert(goal);
+	candidates.clear();
+	consequents_.retrieve_generalizations(store_, goal, candidates);
+	std::ranges::sort(candidates);
+
+	std::vector<term_id> implications;
+	for (const auto &j : candidates)
+	{
+		if (!retired_[j])
+		{
+			implications.push_back(axioms_[j]);
+		}
+	}
+
+	// open hypotheses are implications too
+	for (const auto &context : contexts_)
+	{
+		if (store_.term(context.hypothesis).op == operation_t::Implication)
+		{
+			implications.push_back(context.hypothesis);
+		}
+	}
+
+	term_id result = INVALID_TERM;
+	std::vector<term_id> bindings;
+
+	for (const auto &implication : implications)
+	{
+		if (!matches(store_, store_.right(implication), goal, bindings))
+		{
+			continue;
+		}
+
+		const auto subgoal = substitute(store_, store_.left(implication), bindings, store_.max_value(goal));
+		const auto premise = prove_goal(subgoal, depth - 1, max_len, budget);
+		if (premise == INVALID_TERM)
+		{
+			continue;
+		}
+
+		// most general consequence still covers goal
+		auto &arena = *arenas_[0];
+		arena.reset();
+		std::pmr::vector<Term> preorder(&arena);
+
+		if (!modus_ponens(store_, premise, implication, preorder))
+		{
+			continue;
+		}
+
+		const auto fact = store_.intern(Expression(preorder));
+		if (matches(store_, fact, goal))
+		{
+			derive(fact, premise, implication);
+			result = fact;
+			break;
+		}
+	}
+
+	open_goals_.erase(goal);
+
+	if (result == INVALID_TERM)
+	{
+		(contexts_.empty() ? failed_goals_ : contexts_.back().failed)[goal] = depth;
+		return INVALID_TERM;
+	}
+
+	// contexts_ may have been reallocated by subgoals
+	(contexts_.empty() ? proved_goals_ : contexts_.back().proved)[goal] = result;
+	return result;
+}
+
+
+term_id Solver::proved_goal(term_id goal) const
+{
+	if (auto it = proved_goals_.find(goal); it != proved_goals_.end())
+	{
+		return it->second;
+	}
+
+	for (const auto &context : contexts_)
+	{
+		if (context.hypothesis == goal)
+		{
+			return goal;
+		}
+
+		if (auto it = context.proved.find(goal); it != context.proved.end())
+		{
+			return it->second;
+		}
+	}
+
+	return INVALID_TERM;
+}
+
+
+void Solver::derive(term_id fact, term_id premise, term_id implication)
+{
+	if (contexts_.empty())
+	{
+		record(fact, "mp", {premise, implication});
+		return;
+	}
+
+	// facts of knowledge base and of outer contexts are cited, discharge lifts them
+	auto &derivation = contexts_.back().derivation;
+	derivation.mp(derivation.axiom_instance(premise), derivation.axiom_instance(implication), fact);
+}
+
+
+term_id Solver::prove_by_deduction(term_id goal, std::size_t depth, std::size_t max_len, std::size_t &budget)
+{
+	const auto hypothesis = store_.left(goal);
+	contexts_.push_back({hypothesis, Derivation(store_), {}, {}});
+	contexts_.back().derivation.hypothesis(hypothesis);
+
+	open_goals_.insert(goal);
+	const auto consequent = prove_goal(store_.right(goal), depth, max_len, budget);
+	open_goals_.erase(goal);
+
+	auto context = std::move(contexts_.back());
+	contexts_.pop_back();
+
+	if (consequent == INVALID_TERM)
+	{
+		return INVALID_TERM;
+	}
+
+	// the last line is the one discharged into goal
+	context.derivation.axiom_instance(consequent);
+	const auto derivation = context.derivation.discharge(hypothesis);
+	const auto fact = derivation.fact(derivation.goal());
+
+	if (!contexts_.empty())
+	{
+		contexts_.back().derivation.append(derivation);
+		return fact;
+	}
+
+	// derivation is pure Hilbert one, its steps join proofs
+	for (std::size_t i = 0; i < derivation.size(); ++i)
+	{
+		std::size_t premise, implication;
+		if (derivation.is_mp(i, premise, implication))
+		{
+			record(derivation.fact(i), "mp", {derivation.fact(premise), derivation.fact(implication)});
+		}
+		else
+		{
+			record(derivation.fact(i), "axiom");
+		}
+	}
+
+	return fact;
+}
+
+
+bool Solver::backward_chaining(std::size_t max_len)
+{
+	// knowledge base has grown since previous search
+	failed_goals_.clear();
+	std::size_t budget = BACKWARD_GOALS;
+
+	for (std::size_t depth = 1; depth <= backward_depth_; ++depth)
+	{
+		for (const auto &target : targets_)
+		{
+			const auto fact = prove_goal(target, depth, max_len, budget);
+			if (fact != INVALID_TERM && is_target_proved_by(fact))
+			{
+				axioms_.push_back(fact);
+				retired_.push_back(false);
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+
+bool Solver::raise_subgoal(term_id goal, std::uint32_t parent, term_id implication, std::size_t max_len)
+{
+	goal = store_.normalize(goal);
+
+	if (store_.size(goal) > max_len || !subgoal_ids_.insert(goal).second)
+	{
+		return false;
+	}
+
+	const auto idx = static_cast<std::uint32_t>(subgoals_.size());
+	subgoals_.push_back({goal, parent, implication});
+	open_subgoals_.insert(store_, goal, idx);
+
+	// new subgoal meets facts which are known already
+	std::vector<std::uint32_t> candidates;
+	facts_.retrieve_generalizations(store_, goal, candidates);
+	std::ranges::sort(candidates);
+
+	return std::ranges::any_of(candidates, [&] (auto j) {
+		return !governor_.stopped() && !retired_[j] &&
+			matches(store_, axioms_[j], goal) && close_subgoal(idx, axioms_[j]);
+	});
+}
+
+
+bool Solver::close_subgoal(std::uint32_t subgoal, term_id fact)
+{
+	auto &arena = *arenas_[0];
+	auto premise = fact;
+
+	for (auto current = subgoal; subgoals_[current].parent != NO_PARENT; current = subgoals_[current].parent)
+	{
+		if (governor_.stopped())
+		{
+			return false;
+		}
+
+		const auto &node = subgoals_[current];
+
+		// most general consequence still covers parent goal
+		arena.reset();
+		std::pmr::vector<Term> preorder(&arena);
+
+		if (!modus_ponens(store_, premise, node.implication, preorder))
+		{
+			return false;
+		}
+
+		const auto consequence = store_.intern(Expression(preorder));
+		if (!matches(store_, consequence, subgoals_[node.parent].goal))
+		{
+			return false;
+		}
+
+		record(consequence, "mp", {premise, node.implication});
+		premise = consequence;
+	}
+
+	if (!is_target_proved_by(premise))
+	{
+		return false;
+	}
+
+	++stats_.meetings;
+	axioms_.push_back(premise);
+	retired_.push_back(false);
+	return true;
+}
+
+
+bool Solver::bidirectional_step(std::size_t max_len)
+{
+	if (subgoals_.empty())
+	{
+		for (const auto &target : targets_)
+		{
+			if (raise_subgoal(target, NO_PARENT, INVALID_TERM, max_len))
+			{
+				return true;
+			}
+		}
+	}
+
+	// forward frontier: new facts close subgoals they generalize
+	std::vector<std::uint32_t> candidates;
+	for (auto j = met_facts_; j < axioms_.size(); ++j)
+	{
+		// search is given up, so frontier isn't met completely
+		if (governor_.stopped())
+		{
+			return false;
+		}
+
+		if (retired_[j])
+		{
+			continue;
+		}
+
+		candidates.clear();
+		open_subgoals_.retrieve_instances(store_, axioms_[j], candidates);
+		std::ranges::sort(candidates);
+
+		for (const auto &subgoal : candidates)
+		{
+			if (governor_.stopped())
+			{
+				return false;
+			}
+
+			if (matches(store_, axioms_[j], subgoals_[subgoal].goal) && close_subgoal(subgoal, axioms_[j]))
+			{
+				return true;
+			}
+		}
+	}
+	met_facts_ = axioms_.size();
+
+	// backward frontier: subgoals raise antecedents of implications whose
+	// consequents generalize them, smaller subgoals are expanded first
+	// and old subgoals only try new implications
+	const auto old_subgoals = subgoals_.size();
+	std::vector<term_id> bindings;
+
+	using entry_t = std::pair<std::size_t, std::uint32_t>;
+	std::priority_queue<entry_t, std::vector<entry_t>, std::greater<>> queue;
+	for (std::uint32_t idx = 0; idx < subgoals_.size(); ++idx)
+	{
+		queue.emplace(store_.size(subgoals_[idx].goal), idx);
+	}
+
+	while (!queue.empty() && subgoals_.size() < backward_budget_)
+	{
+		if (governor_.stopped())
+		{
+			return false;
+		}
+
+		const auto idx = queue.top().second;
+		const auto goal = subgoals_[idx].goal;
+		queue.pop();
+
+		candidates.clear();
+		consequents_.retrieve_generalizations(store_, goal, candidates);
+		std::ranges::sort(candidates);
+
+		for (const auto &j : candidates)
+		{
+			if (governor_.stopped())
+			{
+				return false;
+			}
+
+			if (retired_[j] || (idx < old_subgoals && j < expanded_facts_))
+			{
+				continue;
+			}
+
+			const auto implication = axioms_[j];
+			if (!matches(store_, store_.right(implication), goal, bindings))
+			{
+				continue;
+			}
+
+			const auto subgoal = substitute(store_, store_.left(implication), bindings, store_.max_value(goal));
+			const auto count = subgoals_.size();
+
+			if (raise_subgoal(subgoal, idx, implication, max_len))
+			{
+				return true;
+			}
+
+			if (subgoals_.size() != count)
+			{
+				queue.emplace(store_.size(subgoals_.back().goal), subgoals_.size() - 1);
+			}
+
+			if (subgoals_.size() >= backward_budget_)
+			{
+				break;
+			}
+		}
+	}
+	expanded_facts_ = axioms_.size();
+
+	return false;
+}
+
+
+std::size_t Solver::level(term_id fact) const
+{
+	const auto it = levels_.find(fact);
+	return it == levels_.end() ? 0 : it->second;
+}
+
+
+std::size_t Solver::level(std::span<const term_id> premises) const
+{
+	std::size_t result = 0;
+	for (const auto &premise : premises)
+	{
+		result = std::max(result, level(premise));
+	}
+
+	return result;
+}
+
+
+bool Solver::is_target_proved_by(term_id expression)
+{
+	return is_target_proved_by(expression, level(expression));
+}
+
+
+bool Solver::is_target_proved_by(term_id expression, std::size_t level)
+{
+	if (expression == INVALID_TERM)
+	{
+		return false;
+	}
+
+	// target may be an instance of more general fact, hypotheses of later targets aren't available
+	for (std::size_t k = level; k < targets_.size(); ++k)
+	{
+		if (is_equal(store_, targets_[k], expression) || matches(store_, expression, targets_[k]))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+bool Solver::is_subsumed(term_id expression)
+{
+	std::vector<std::uint32_t> candidates;
+	facts_.retrieve_generalizations(store_, expression, candidates);
+
+	return std::ranges::any_of(candidates, [&] (auto j) {
+		return !retired_[j] && matches(store_, axioms_[j], expression);
+	});
+}
+
+
+void Solver::retire_instances(term_id expression)
+{
+	std::vector<std::uint32_t> candidates;
+	facts_.retrieve_instances(store_, expression, candidates);
+
+	for (const auto &j : candidates)
+	{
+		if (!retired_[j] && matches(store_, expression, axioms_[j]))
+		{
+			retired_[j] = true;
+		}
+	}
+}
+
+
+bool Solver::is_target_proved_by(const Expression &expression, std::size_t level) const
+{
+	if (expression.empty())
+	{
+		return false;
+	}
+
+	for (std::size_t k = level; k < target_expressions_.size(); ++k)
+	{
+		if (target_expressions_[k].equals(expression))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+bool Solver::is_good_expression(std::span<const Term> preorder, std::size_t max_len) const
+{
+	const auto conjunctions = std::ranges::count_if(preorder, [] (const auto &term) {
+		return term.type == term_t::Function && term.op == operation_t::Conjunction;
+	});
+
+	return !(preorder.size() > max_len || preorder.empty() ||
+		preorder[0].op == operation_t::Conjunction ||
+		conjunctions > 1);
+}
+
+
+bool Solver::deduction_theorem_decomposition(term_id expression)
+{
+	if (expression == INVALID_TERM)
+	{
+		return false;
+	}
+
+	if (store_.term(expression).op != operation_t::Implication)
+	{
+		return false;
+	}
+
+	// Γ ⊢ A → B <=> Γ U {A} ⊢ B
+	axioms_.push_back(store_.left(expression));
+	targets_.push_back(store_.right(expression));
+	return true;
+}
+
+
+bool Solver::activate(term_id fact, bool keep)
+{
+	// forward and backward subsumption, instances of facts
+	// only produce instances of their consequences
+	if (!keep && is_subsumed(fact))
+	{
+		return false;
+	}
+	retire_instances(fact);
+
+	const auto index = static_cast<std::uint32_t>(axioms_.size());
+	axioms_.push_back(fact);
+	retired_.push_back(false);
+
+	facts_.insert(store_, fact, index);
+	if (store_.term(fact).op == operation_t::Implication)
+	{
+		antecedents_.insert(store_, store_.left(fact), index);
+		consequents_.insert(store_, store_.right(fact), index);
+	}
+
+	return true;
+}
+
+
+void Solver::produce(std::size_t max_len)
+{
+	if (produced_.empty())
+	{
+		return;
+	}
+
+	// capped frontier mostly goes to disk
+	std::vector<term_id> newly_produced;
+	if (memory_cap_ == UNLIMITED)
+	{
+		newly_produced.reserve(2 * produced_.size());
+	}
+
+	// step 1: extend knowledge base with previous generation
+	const auto first = axioms_.size();
+
+	for (const auto &expression : produced_)
+	{
+		// subsumption checks of large generation take long
+		if (governor_.stopped())
+		{
+			return;
+		}
+
+		if (store_.size(expression) > max_len)
+		{
+			deferred_.push_back(expression);
+			continue;
+		}
+
+		const auto fact = store_.normalize(expression);
+		const bool proves_target = is_target_proved_by(fact);
+
+		if (activate(fact, proves_target) && proves_target)
+		{
+			return;
+		}
+	}
+
+	// step 2: combine every new fact with knowledge base up to it,
+	// store and indices are only read by workers
+	std::vector<std::deque<Candidate>> buffers(pool_.size());
+	CandidateSet candidates;
+
+	// smallest order of candidate which proves target
+	std::atomic<std::uint64_t> proof_order = std::numeric_limits<std::uint64_t>::max();
+
+	// new facts of current chunk start here
+	auto begin = first;
+
+	auto combine = [&] (std::size_t task, std::size_t worker)
+	{
+		const auto index = static_cast<std::uint32_t>(begin + task);
+		const auto fact = axioms_[index];
+
+		// nothing after proof is required
+		if (retired_[index] || (proof_order.load() >> 32) < index || governor_.stopped())
+		{
+			return;
+		}
+
+		// retrieve only partners which may be unified with new fact
+		std::vector<std::uint32_t> premises;
+		std::vector<std::uint32_t> implications;
+
+		if (store_.term(fact).op == operation_t::Implication)
+		{
+			facts_.retrieve_unifiable(store_, store_.left(fact), premises);
+		}
+		antecedents_.retrieve_unifiable(store_, fact, implications);
+
+		std::erase_if(premises, [&] (auto j) { return j > index || retired_[j]; });
+		std::erase_if(implications, [&] (auto j) { return j >= index || retired_[j]; });
+		std::ranges::sort(premises);
+		std::ranges::sort(implications);
+
+		std::uint64_t attempt = 0;
+		auto &arena = *arenas_[worker];
+
+		// true stops combinations of fact
+		auto add = [&] (std::uint32_t rule, std::span<const term_id> facts)
+		{
+			if (governor_.stopped())
+			{
+				return true;
+			}
+
+			const auto order = static_cast<std::uint64_t>(index) << 32 | attempt++;
+
+			// scratch of previous attempt is released at once
+			arena.reset();
+			std::pmr::vector<Term> preorder(&arena);
+
+			const bool applied = rule == MODUS_PONENS ?
+				modus_ponens(store_, facts[0], facts[1], preorder) :
+				apply(store_, rules_[rule], facts, preorder);
+
+			// only good expressions leave the arena
+			if (!applied || !is_good_expression(preorder, max_len))
+			{
+				return false;
+			}
+
+			Expression expr(preorder);
+
+			// expression is known only if it's already stored
+			const auto stored = store_.find(expr);
+			if (stored != INVALID_TERM && known_axioms_.contains(stored))
+			{
+				return false;
+			}
+
+			const auto hash = expr.hash();
+			auto &buffer = buffers[worker];
+			buffer.push_back({std::move(expr), hash, order, rule, {}});
+			buffer.back().premises.assign(facts.data(), facts.data() + facts.size());
+
+			if (!candidates.insert(hash, order, buffer.back().expression))
+			{
+				buffer.pop_back();
+				return false;
+			}
+
+			if (is_target_proved_by(buffer.back().expression, level(facts)))
+			{
+				auto current = proof_order.load();
+				while (order < current &&
+					!proof_order.compare_exchange_weak(current, order))
+				{}
+			}
+
+			return false;
+		};
+
+		// produce new expressions in order of knowledge base
+		auto premise = premises.begin();
+		auto implication = implications.begin();
+
+		while ((premise != premises.end() || implication != implications.end()) && !governor_.stopped())
+		{
+			const auto j = std::min(
+				premise != premises.end() ? *premise : index,
+				implication != implications.end() ? *implication : index
+			);
+
+			if (premise != premises.end() && *premise == j)
+			{
+				++premise;
+				add(MODUS_PONENS, std::array{axioms_[j], fact});
+			}
+
+			// inverse order, a, a > a is already produced
+			if (implication != implications.end() && *implication == j)
+			{
+				++implication;
+				add(MODUS_PONENS, std::array{fact, axioms_[j]});
+			}
+		}
+
+		combine_rules(index, add);
+	};
+
+	// steps 2 and 3 run over chunks of new facts if memory is capped, so only
+	// candidates of one chunk are buffered. Later chunks have larger orders and
+	// don't produce known facts again, so result is the same as of one pass
+	const auto last = axioms_.size();
+	while (begin < last && !governor_.stopped())
+	{
+		const auto end = memory_cap_ == UNLIMITED ? last : std::min(last, begin + chunk_);
+		pool_.run(end - begin, combine);
+
+		// step 3: merge kept candidates in sequential order
+		std::vector<Candidate *> merged;
+		for (auto &buffer : buffers)
+		{
+			for (auto &candidate : buffer)
+			{
+				if (candidates.owns(candidate.hash, candidate.order, candidate.expression))
+				{
+					merged.push_back(&candidate);
+				}
+			}
+		}
+
+		std::ranges::sort(merged, [] (const auto *lhs, const auto *rhs) {
+			return lhs->order < rhs->order;
+		});
+
+		for (const auto *candidate : merged)
+		{
+			// rest of generation is dropped, knowledge base stays consistent
+			if (governor_.stopped())
+			{
+				break;
+			}
+
+			// past memory cap new facts wait on disk unless they prove target
+			const auto depth = level(candidate->premises);
+			if (over_cap() && !is_target_proved_by(candidate->expression, depth))
+			{
+				stats_.spilled += spill_.push(candidate->expression, candidate->hash, candidate->rule, candidate->premises) ? 1 : 0;
+				continue;
+			}
+
+			const auto expr = store_.intern(candidate->expression);
+			known_axioms_.insert(expr);
+
+			const bool proves_target = is_target_proved_by(expr, depth);
+			if (!proves_target && is_subsumed(expr))
+			{
+				continue;
+			}
+
+			newly_produced.push_back(expr);
+			record(expr, rule_name(candidate->rule), {candidate->premises.begin(), candidate->premises.end()});
+
+			if (proves_target)
+			{
+				axioms_.push_back(expr);
+				retired_.push_back(false);
+				return;
+			}
+		}
+
+		// chunk is resized until its candidates take 1/32 - 1/8 of memory cap
+		if (memory_cap_ != UNLIMITED)
+		{
+			std::uint64_t bytes = 0;
+			for (const auto &buffer : buffers)
+			{
+				for (const auto &candidate : buffer)
+				{
+					bytes += sizeof(Candidate) + candidate.expression.size() * sizeof(Term);
+				}
+			}
+
+			if (bytes > memory_cap_ / 8)
+			{
+				chunk_ = std::max<std::size_t>(1, chunk_ / 2);
+			}
+			else if (bytes < memory_cap_ / 32)
+			{
+				chunk_ = std::min(2 * chunk_, last);
+			}
+		}
+
+		for (auto &buffer : buffers)
+		{
+			buffer.clear();
+		}
+		candidates.clear();
+		begin = end;
+	}
+
+	if (governor_.check())
+	{
+		return;
+	}
+
+	std::ranges::sort(newly_produced, [&] (const auto &lhs, const auto &rhs) {
+		return store_.size(lhs) < store_.size(rhs);
+	});
+
+	// the largest facts are deferred if frontier is over budget
+	if (newly_produced.size() > forward_budget_)
+	{
+		deferred_.insert(deferred_.end(), newly_produced.begin() + forward_budget_, newly_produced.end());
+		newly_produced.resize(forward_budget_);
+	}
+
+	produced_ = std::move(newly_produced);
+}
+
+
+const std::string &Solver::rule_name(std::uint32_t rule) const
+{
+	static const std::string modus_ponens = "mp";
+	return rule == MODUS_PONENS ? modus_ponens : rules_[rule].name;
+}
+
+
+void Solver::combine_rules(
+	std::uint32_t index,
+	const std::function<bool(std::uint32_t, std::span<const term_id>)> &apply
+) const
+{
+	if (rules_.empty())
+	{
+		return;
+	}
+
+	std::vector<std::pair<std::uint32_t, std::uint32_t>> places;
+	rules_.premises_of(store_, axioms_[index], places);
+
+	std::vector<term_id> tuple;
+	std::pmr::vector<Term> query;
+	bool stop = false;
+
+	for (const auto &[rule, position] : places)
+	{
+		tuple.assign(rules_[rule].premises.size(), INVALID_TERM);
+		tuple[position] = axioms_[index];
+
+		// premises before the one of new fact take only older facts
+		std::function<void(std::size_t)> fill = [&] (std::size_t k)
+		{
+			if (k == tuple.size())
+			{
+				stop = apply(rule, tuple);
+				return;
+			}
+
+			if (k == position)
+			{
+				fill(k + 1);
+				return;
+			}
+
+			if (!instantiate_premise(store_, rules_[rule], tuple, k, query))
+			{
+				return;
+			}
+
+			std::vector<std::uint32_t> partners;
+			facts_.retrieve_unifiable(query, partners);
+			std::ranges::sort(partners);
+
+			for (const auto &j : partners)
+			{
+				if (stop || j > index || (k < position && j == index) || retired_[j])
+				{
+					continue;
+				}
+
+				tuple[k] = axioms_[j];
+				fill(k + 1);
+			}
+
+			tuple[k] = INVALID_TERM;
+		};
+
+		fill(0);
+
+		if (stop)
+		{
+			return;
+		}
+	}
+}
+
+
+FactInfo Solver::describe(term_id fact, std::uint64_t age, const std::vector<term_id> &target_subterms)
+{
+	auto depth = depths_.find(fact);
+
+	FactInfo info{
+		store_.size(fact),
+		depth == depths_.end() ? 0 : depth->second,
+		store_.variables(fact).size(),
+		0,
+		age
+	};
+
+	// subformulas which may be instantiated to subformulas of targets
+	std::stack<term_id> s;
+	s.push(fact);
+
+	while (!s.empty())
+	{
+		const auto current = s.top();
+		s.pop();
+
+		if (store_.term(current).type != term_t::Function)
+		{
+			continue;
+		}
+
+		info.similarity += std::ranges::any_of(target_subterms, [&] (auto target) {
+			return store_.term(target).op == store_.term(current).op &&
+				matches(store_, current, target);
+		}) ? 1 : 0;
+
+		s.push(store_.left(current));
+		s.push(store_.right(current));
+	}
+
+	return info;
+}
+
+
+void Solver::given_clause(std::size_t max_len)
+{
+	std::vector<term_id> target_subterms;
+	for (const auto &target : targets_)
+	{
+		std::stack<term_id> s;
+		s.push(target);
+
+		while (!s.empty())
+		{
+			const auto current = s.top();
+			s.pop();
+
+			if (store_.term(current).type == term_t::Function)
+			{
+				target_subterms.push_back(current);
+				s.push(store_.left(current));
+				s.push(store_.right(current));
+			}
+		}
+	}
+
+	std::ranges::sort(target_subterms);
+	target_subterms.erase(std::ranges::unique(target_subterms).begin(), target_subterms.end());
+
+	// passive facts by weight and by age, ties of weight are resolved by age
+	using entry_t = std::tuple<double, std::uint64_t, term_id>;
+	std::priority_queue<entry_t, std::vector<entry_t>, std::greater<>> lightest;
+	std::queue<term_id> oldest;
+	std::unordered_set<term_id> selected;
+	std::uint64_t age = 0;
+
+	auto passive = [&] (term_id fact)
+	{
+		lightest.emplace(weight_(describe(fact, age, target_subterms)), age, fact);
+		if (age_ratio_ != 0)
+		{
+			oldest.push(fact);
+		}
+
+		++age;
 	};
 
-	axioms.emplace_back(modus_ponens(axioms[0], axioms[0]));
-	axioms.emplace_back(modus_ponens(axioms[1], axioms[0]));
-	axioms.emplace_back(modus_ponens(axioms[3], axioms[1]));
-	axioms.emplace_back(modus_ponens(axioms[4], axioms[1]));
-	axioms.emplace_back(modus_ponens(axioms[2], axioms[5]));
-	axioms.emplace_back(modus_ponens(axioms[6], axioms[6]));
-	axioms.emplace_back(modus_ponens(axioms[7], axioms[8]));
-	axioms.emplace_back(modus_ponens(axioms[3], axioms[9]));
+	for (const auto &expression : produced_)
+	{
+		if (store_.size(expression) > max_len)
+		{
+			deferred_.push_back(expression);
+			continue;
+		}
 
-	dump_ << axioms[3] << ' ' << "mp" << ' ' << axioms[0] << ' ' << axioms[0] << '\n';
-	dump_ << axioms[4] << ' ' << "mp" << ' ' << axioms[1] << ' ' << axioms[0] << '\n';
-	dump_ << axioms[5] << ' ' << "mp" << ' ' << axioms[3] << ' ' << axioms[1] << '\n';
-	dump_ << axioms[6] << ' ' << "mp" << ' ' << axioms[4] << ' ' << axioms[1] << '\n';
-	dump_ << axioms[7] << ' ' << "mp" << ' ' << axioms[2] << ' ' << axioms[5] << '\n';
-	dump_ << axioms[8] << ' ' << "mp" << ' ' << axioms[6] << ' ' << axioms[5] << '\n';
-	dump_ << axioms[9] << ' ' << "mp" << ' ' << axioms[7] << ' ' << axioms[8] << '\n';
-	dump_ << axioms[10] << ' ' << "mp" << ' ' << axioms[3] << ' ' << axioms[9] << '\n';
-}
+		const auto fact = store_.normalize(expression);
+		known_axioms_.insert(fact);
+		passive(fact);
+	}
+	produced_.clear();
 
+	auto &arena = *arenas_[0];
+	std::vector<std::uint32_t> premises;
+	std::vector<std::uint32_t> implications;
 
-bool Solver::is_target_proved_by(const Expression &expression) const
-{
-	if (expression.empty())
+	// consequence proves target or is added to passive facts
+	auto add = [&] (std::uint32_t rule, std::span<const term_id> facts)
 	{
-		return false;
-	}
+		arena.reset();
+		std::pmr::vector<Term> preorder(&arena);
 
-	for (const auto &target : targets_)
-	{
-		if (is_equal(target, expression))
+		const bool applied = rule == MODUS_PONENS ?
+			modus_ponens(store_, facts[0], facts[1], preorder) :
+			apply(store_, rules_[rule], facts, preorder);
+
+		if (!applied || !is_good_expression(preorder, max_len))
 		{
-			return true;
+			return false;
 		}
-	}
 
-	return false;
-}
+		Expression expression(preorder);
 
+		// past memory cap new facts wait on disk unless they prove target
+		if (over_cap() && !is_target_proved_by(expression, level(facts)))
+		{
+			const auto stored = store_.find(expression);
+			if (stored == INVALID_TERM || !known_axioms_.contains(stored))
+			{
+				stats_.spilled += spill_.push(expression, expression.hash(), rule, facts) ? 1 : 0;
+			}
 
-bool Solver::is_good_expression(const Expression &expression, std::size_t max_len) const
-{
-	return !(expression.size() > max_len || expression.empty() ||
-		expression[0].op == operation_t::Conjunction ||
-		expression.operations(operation_t::Conjunction) > 1);
-}
+			return false;
+		}
 
+		const auto fact = store_.intern(expression);
+		const bool proves_target = is_target_proved_by(fact, level(facts));
 
-bool Solver::deduction_theorem_decomposition(Expression expression)
-{
-	if (expression.empty())
-	{
-		return false;
-	}
+		if (!known_axioms_.insert(fact).second || (!proves_target && is_subsumed(fact)))
+		{
+			return false;
+		}
 
-	if (expression[0].op != operation_t::Implication)
-	{
-		return false;
-	}
+		std::size_t depth = 0;
+		for (const auto &premise : facts)
+		{
+			depth = std::max(depth, depths_[premise]);
+		}
 
-	// Γ ⊢ A → B <=> Γ U {A} ⊢ B
-	axioms_.emplace_back(expression.subtree_copy(expression.subtree(0).left()));
-	targets_.emplace_back(expression.subtree_copy(expression.subtree(0).right()));
-	return true;
-}
+		record(fact, rule_name(rule), {facts.begin(), facts.end()});
+		depths_[fact] = 1 + depth;
+
+		if (proves_target)
+		{
+			axioms_.push_back(fact);
+			retired_.push_back(false);
+			return true;
+		}
 
+		passive(fact);
+		return false;
+	};
 
-void Solver::produce(std::size_t max_len)
-{
-	if (produced_.empty())
+	while (!governor_.stopped())
 	{
-		return;
-	}
+		// every age_ratio-th given fact is the oldest one
+		const bool by_age = age_ratio_ != 0 && stats_.activations % age_ratio_ == age_ratio_ - 1;
+		term_id given = INVALID_TERM;
 
-	std::vector<Expression> newly_produced;
-	newly_produced.reserve(2 * produced_.size());
+		while (given == INVALID_TERM && !(lightest.empty() && oldest.empty()))
+		{
+			term_id fact = INVALID_TERM;
+			if ((by_age && !oldest.empty()) || lightest.empty())
+			{
+				fact = oldest.front();
+				oldest.pop();
+			}
+			else
+			{
+				fact = std::get<2>(lightest.top());
+				lightest.pop();
+			}
 
-	Expression expr;
-	std::string repr;
+			if (selected.insert(fact).second)
+			{
+				given = fact;
+			}
+		}
 
-	for (auto &expression : produced_)
-	{
-		if (ms_since_epoch() > time_limit_)
+		// passive facts on disk come back once the ones in memory are used up
+		if (given == INVALID_TERM && !spill_.empty())
 		{
-			break;
+			for (const auto &fact : restore(RESTORED_FACTS))
+			{
+				passive(fact);
+			}
+			continue;
 		}
 
-		if (expression.size() > max_len)
+		// search space is exhausted
+		if (given == INVALID_TERM)
 		{
-			continue;
+			return;
 		}
 
-		// add expression
-		expression.normalize();
-		axioms_.push_back(expression);
+		++stats_.activations;
 
-		if (is_target_proved_by(axioms_.back()))
+		const bool proves_target = is_target_proved_by(given);
+		if (!activate(given, proves_target))
 		{
-			return;
+			continue;
 		}
 
-		// produce new expressions
-		for (std::size_t j = 0; j < axioms_.size(); ++j)
+		if (proves_target)
 		{
-			expr = std::move(modus_ponens(axioms_[j], axioms_.back()));
+			return;
+		}
 
-			if (!is_good_expression(expr, max_len) ||
-				known_axioms_.contains(expr.to_string()))
-			{
-				continue;
-			}
+		// combine given fact with active ones and with itself
+		const auto index = static_cast<std::uint32_t>(axioms_.size() - 1);
+		premises.clear();
+		implications.clear();
 
-			newly_produced.emplace_back(expr);
-			known_axioms_.insert(newly_produced.back().to_string());
+		if (store_.term(given).op == operation_t::Implication)
+		{
+			facts_.retrieve_unifiable(store_, store_.left(given), premises);
+		}
+		antecedents_.retrieve_unifiable(store_, given, implications);
 
-			dump_ << newly_produced.back() << ' ' << "mp" << ' '
-			<< axioms_[j] << ' ' << axioms_.back() << '\n';
+		std::ranges::sort(premises);
+		std::ranges::sort(implications);
 
-			if (is_target_proved_by(newly_produced.back()))
+		for (const auto &j : premises)
+		{
+			if (!retired_[j] && add(MODUS_PONENS, std::array{axioms_[j], given}))
 			{
-				axioms_.push_back(newly_produced.back());
 				return;
 			}
+		}
 
-			if (j + 1 == axioms_.size())
+		for (const auto &j : implications)
+		{
+			if (!retired_[j] && j != index && add(MODUS_PONENS, std::array{given, axioms_[j]}))
 			{
-				break;
+				return;
 			}
+		}
 
-			// inverse order
-			expr = std::move(modus_ponens(axioms_.back(), axioms_[j]));
+		bool proved = false;
+		combine_rules(index, [&] (std::uint32_t rule, std::span<const term_id> tuple) {
+			proved = add(rule, tuple);
+			return proved;
+		});
 
-			if (!is_good_expression(expr, max_len) ||
-				known_axioms_.contains(expr.to_string()))
-			{
-				continue;
-			}
+		if (proved)
+		{
+			return;
+		}
+	}
+}
 
-			newly_produced.emplace_back(expr);
-			known_axioms_.insert(newly_produced.back().to_string());
 
-			dump_ << newly_produced.back() << ' ' << "mp" << ' '
-			<< axioms_.back() << ' ' << axioms_[j] << '\n';
+bool Solver::search(std::size_t max_len)
+{
+	if (strategy_ == Strategy::GivenClause)
+	{
+		given_clause(max_len);
+		return !axioms_.empty() && is_target_proved_by(axioms_.back());
+	}
 
-			if (is_target_proved_by(newly_produced.back()))
-			{
-				axioms_.push_back(newly_produced.back());
-				return;
-			}
+	while (!governor_.check())
+	{
+		if (produced_.empty())
+		{
+			produced_ = restore(RESTORED_FACTS);
+		}
+
+		stats_.forward_frontier.push_back(produced_.size());
+		produce(max_len);
+
+		if (!axioms_.empty() && is_target_proved_by(axioms_.back()))
+		{
+			return true;
+		}
+
+		// generation was cut short, so subgoals aren't searched
+		if (governor_.stopped())
+		{
+			return false;
+		}
+
+		if (strategy_ == Strategy::Backward && backward_chaining(max_len))
+		{
+			return true;
+		}
+
+		const bool met = strategy_ == Strategy::Bidirectional && bidirectional_step(max_len);
+		stats_.backward_frontier.push_back(subgoals_.size());
+
+		// no new fact is produced under current bound
+		if (met || (produced_.empty() && spill_.empty()))
+		{
+			return met;
 		}
 	}
 
-	if (ms_since_epoch() > time_limit_)
+	return false;
+}
+
+
+std::size_t Solver::initial_bound() const
+{
+	if (initial_size_ != 0)
+	{
+		return initial_size_;
+	}
+
+	// intermediate facts are usually a bit larger than targets,
+	// and every axiom should be usable at once
+	std::size_t bound = 0;
+	for (const auto &target : targets_)
+	{
+		bound = std::max(bound, store_.size(target) + size_step_);
+	}
+
+	for (const auto &axiom : axioms_)
 	{
-		return;
+		bound = std::max(bound, store_.size(axiom));
 	}
 
-	std::ranges::sort(newly_produced, [] (const auto &lhs, const auto &rhs) {
-		return lhs.size() < rhs.size();
-	});
+	return std::min(bound, max_size_);
+}
 
-	produced_ = std::move(newly_produced);
+
+void Solver::restart()
+{
+	produced_.clear();
+	for (std::size_t i = 0; i < axioms_.size(); ++i)
+	{
+		if (!retired_[i])
+		{
+			produced_.push_back(axioms_[i]);
+		}
+	}
+
+	produced_.insert(produced_.end(), deferred_.begin(), deferred_.end());
+	deferred_.clear();
+
+	// known facts are kept, so only consequences over previous bound are new
+	axioms_.clear();
+	retired_.clear();
+	facts_.clear();
+	antecedents_.clear();
+	consequents_.clear();
+
+	// subgoals over previous bound weren't raised
+	subgoals_.clear();
+	subgoal_ids_.clear();
+	open_subgoals_.clear();
+	met_facts_ = 0;
+	expanded_facts_ = 0;
 }
 
 
@@ -212,184 +1794,289 @@ void Solver::solve()
 {
 	ss.clear();
 
-	// we will produce at most m operations in one expression
-	// if more operations are required, increase it
-	std::size_t len = 20;
+	// sound axioms prove only tautologies, so falsifiable target is rejected at once
+	if (std::ranges::all_of(axioms_, [&] (const auto &axiom) { return is_tautology(store_.expression(axiom)); }))
+	{
+		if (const auto assignment = counterexample(store_.expression(targets_.back())))
+		{
+			ss << "counterexample: " << to_string(*assignment) << '\n';
+			ss << "No proof exists, input is not a tautology\n";
+			return;
+		}
+	}
+
+	// Kalmár construction and discharge of hypotheses need the standard axioms,
+	// hypotheses are added below
+	const bool hilbert = std::ranges::all_of(hilbert_axioms(), [&] (const auto &axiom) {
+		const auto id = store_.normalize(store_.intern(axiom));
+		return std::ranges::any_of(axioms_, [&] (term_id known) { return store_.normalize(known) == id; });
+	});
+	const bool kalmar = hilbert && kalmar_atoms_ != 0 && kalmar_supported(store_, targets_.front(), kalmar_atoms_);
+	deduction_ = hilbert;
 
 	// simplify target if it's possible
+	const auto first_hypothesis = axioms_.size();
 	while (deduction_theorem_decomposition(targets_.back()))
 	{
-		auto &prev = targets_[targets_.size() - 2];
-		auto &curr = targets_.back();
-		auto &axiom = axioms_.back();
+		const auto prev = targets_[targets_.size() - 2];
+		const auto curr = targets_.back();
+		const auto axiom = axioms_.back();
+
+		ss << "deduction theorem: " << "Γ ⊢ " << store_.to_string(prev)
+		<< " <=> " << "Γ U {" << store_.to_string(axiom) << "} ⊢ "
+		<< store_.to_string(curr) << '\n';
+	}
 
-		ss << "deduction theorem: " << "Γ ⊢ " << prev << " <=> "
-		<< "Γ U {" << axiom << "} ⊢ " << curr << '\n';
+	for (const auto &target : targets_)
+	{
+		target_expressions_.push_back(store_.expression(store_.normalize(target)));
 	}
 
 	// write all axioms to produced array
 	for (std::size_t i = 0; i < axioms_.size(); ++i)
 	{
-		axioms_[i].normalize();
+		axioms_[i] = store_.normalize(axioms_[i]);
 		produced_.push_back(axioms_[i]);
-		dump_ << axioms_[i] << ' ' << "axiom" << '\n';
+		record(axioms_[i], "axiom");
+
+		if (i >= first_hypothesis)
+		{
+			hypotheses_.insert(axioms_[i]);
+			levels_.try_emplace(axioms_[i], i - first_hypothesis + 1);
+		}
 	}
 
-	// isr rule
-	produced_.emplace_back(Expression("(!a>!b)>(b>a)"));
+	if (hilbert)
+	{
+		import_table(max_size_);
+	}
+	import_lemmas(max_size_);
+
+	// the first bound depends on axioms, which are moved to knowledge base by search
+	const auto first_bound = initial_bound();
+
+	term_id stored_target = INVALID_TERM;
+	const auto stored_proof = find_stored_proof(stored_target);
+
 	axioms_.clear();
+	retired_.clear();
+	facts_.clear();
+	antecedents_.clear();
+	consequents_.clear();
 	known_axioms_.clear();
 
-	// calculating the stopping criterion
-	const auto time = ms_since_epoch();
-	time_limit_ =
-		time > std::numeric_limits<std::uint64_t>::max() - time_limit_ ?
-		std::numeric_limits<std::uint64_t>::max() :
-		time + time_limit_;
+	// known theorem, its derivation is recorded already
+	if (stored_proof != INVALID_TERM)
+	{
+		proof_ = stored_proof;
+		build_thought_chain(stored_proof, stored_target);
+		if (hilbert)
+		{
+			discharge_hypotheses(stored_proof, stored_target);
+		}
+		return;
+	}
+
+	// deadline is counted from the start of search
+	governor_.start();
 
-	while (ms_since_epoch() < time_limit_)
+	// search which doesn't finish soon gives way to Kalmár construction
+	if (kalmar)
 	{
-		produce(len);
+		governor_.shorten(kalmar_after_ms_);
+	}
 
-		if (is_target_proved_by(axioms_.back()))
+	// iterative deepening: bound is raised every time search is saturated under it,
+	// facts over bound are deferred to the next step
+	auto len = first_bound;
+	while (true)
+	{
+		const auto start = governor_.elapsed_ms();
+		const auto steps = stats_.forward_frontier.size() + stats_.activations;
+		const bool found = search(len);
+
+		stats_.deepening.push_back({
+			len,
+			stats_.forward_frontier.size() + stats_.activations - steps,
+			governor_.elapsed_ms() - start,
+			axioms_.size()
+		});
+
+		if (found || len >= max_size_ || governor_.check())
 		{
 			break;
 		}
+
+		len = std::min(len + size_step_, max_size_);
+		restart();
 	}
 
+	stats_.knowledge_base = axioms_.size();
+	stats_.stop = governor_.reason();
+	stats_.derivations = governor_.derivations();
+	stats_.memory = memory_usage();
+
 	if (std::ranges::none_of(axioms_, [&] (const auto &expression) {
 		return is_target_proved_by(expression);
 	}))
 	{
-		ss << "No proof was found in the time allotted\n";
+		// it's the original target, so it's proved without hypotheses,
+		// search which was cancelled or ran out of memory isn't continued
+		const bool fallback = kalmar && stats_.stop != StopReason::Cancelled && stats_.stop != StopReason::Memory;
+		if (fallback)
+		{
+			// construction has the rest of time limit, search had only its part
+			governor_.resume();
+		}
+
+		const auto chain = fallback ?
+			kalmar_proof(store_, targets_.front(), kalmar_atoms_, [this] { return governor_.stopped(); }) :
+			std::nullopt;
+
+		if (chain)
+		{
+			proof_ = targets_.front();
+			stats_.kalmar_lines = std::ranges::count(*chain, '\n');
+			ss << *chain;
+			return;
+		}
+
+		// construction was cut short by deadline or cancellation too
+		if (governor_.reason() != StopReason::None)
+		{
+			stats_.stop = governor_.reason();
+		}
+
+		switch (stats_.stop)
+		{
+		case StopReason::None:
+			ss << "No proof was found under the size bound\n";
+			break;
+		case StopReason::Deadline:
+			ss << "No proof was found in the time allotted\n";
+			break;
+		case StopReason::Cancelled:
+			ss << "Search was cancelled before a proof was found\n";
+			break;
+		default:
+			ss << "No proof was found within the " << to_string(stats_.stop) << '\n';
+		}
+
+		ss << "Knowledge base has " << stats_.knowledge_base << " facts of "
+			<< stats_.derivations << " derivations\n";
 		return;
 	}
 
 	// find which target was proved
-	Expression proof;
-	Expression target_proved;
+	term_id proof = INVALID_TERM;
+	term_id target_proved = INVALID_TERM;
 
 	for (const auto &axiom : axioms_)
 	{
-		if (!proof.empty())
+		if (proof != INVALID_TERM)
 		{
 			break;
 		}
 
-		for (const auto &target : targets_)
+		for (std::size_t k = level(axiom); k < targets_.size(); ++k)
 		{
-			if (is_equal(target, axiom))
+			if (is_equal(store_, targets_[k], axiom) || matches(store_, axiom, targets_[k]))
 			{
 				proof = axiom;
-				target_proved = target;
+				target_proved = targets_[k];
 				break;
 			}
 		}
 	}
 
 	// build proof chain
-	dump_.flush();
+	proof_ = proof;
 	build_thought_chain(proof, target_proved);
+	if (hilbert)
+	{
+		discharge_hypotheses(proof, target_proved);
+	}
+	publish_lemmas(proof);
 }
 
 
-void Solver::build_thought_chain(Expression proof, Expression proved_target)
+std::vector<term_id> Solver::proof_order(term_id proof) const
 {
-	std::ifstream conclusions("conclusions.txt");
-	std::unordered_map<std::string, Node> conclusions_;
-	std::unordered_map<std::string, std::size_t> indices;
-	std::unordered_set<std::string> processed_proofs;
-	std::unordered_map<std::size_t, Node> chain;
-	std::size_t next_index = 1;
-
-	std::string line;
-	std::string expression;
-	std::string rule;
-	std::string dependency;
+	// postorder of proof DAG
+	std::vector<term_id> order;
+	std::unordered_set<term_id> visited;
+	std::stack<std::pair<term_id, bool>> s;
+	s.emplace(proof, false);
 
-	while (std::getline(conclusions, line))
+	while (!s.empty())
 	{
-		std::istringstream tss(line);
-		tss >> expression >> rule;
+		auto [expression, expanded] = s.top();
+		s.pop();
 
-		if (conclusions_.contains(expression))
+		if (expanded)
 		{
+			order.push_back(expression);
 			continue;
 		}
 
-		conclusions_[expression] = {expression, rule};
-		while (tss >> dependency)
+		if (!visited.insert(expression).second)
 		{
-			conclusions_[expression].dependencies.push_back(dependency);
+			continue;
 		}
-	}
 
-	std::vector<std::vector<std::string>> tree_levels;
-	tree_levels.push_back({proof.to_string()});
+		s.emplace(expression, true);
 
-	while (!tree_levels.back().empty())
-	{
-		std::vector<std::string> level;
-		for (const auto &expression : tree_levels.back())
+		auto it = proofs_.find(expression);
+		if (it == proofs_.end())
 		{
-			auto &node = conclusions_[expression];
-			if (processed_proofs.contains(node.expression))
-			{
-				continue;
-			}
+			continue;
+		}
 
-			if (node.rule == "axiom")
+		const auto &dependencies = it->second.dependencies;
+		for (auto dep = dependencies.rbegin(); dep != dependencies.rend(); ++dep)
+		{
+			if (!visited.contains(*dep))
 			{
-				if (indices.contains(node.expression))
-				{
-					continue;
-				}
-
-				chain[next_index] = node;
-				indices[node.expression] = next_index;
-				++next_index;
+				s.emplace(*dep, false);
 			}
+		}
+	}
 
-			for (const auto &dependency : node.dependencies)
-			{
-				level.push_back(dependency);
-			}
+	return order;
+}
 
-			processed_proofs.insert(node.expression);
-		}
 
-		tree_levels.emplace_back(level);
-	}
+void Solver::build_thought_chain(term_id proof_id, term_id proved_target_id)
+{
+	auto proof = store_.expression(proof_id);
+	auto proved_target = store_.expression(proved_target_id);
 
-	std::ranges::reverse(tree_levels);
+	// facts required by proof in order of dependencies
+	auto order = proof_order(proof_id);
 
-	for (const auto &level : tree_levels)
-	{
-		for (const auto &expression : level)
-		{
-			if (indices.contains(expression))
-			{
-				continue;
-			}
+	// axioms go first, derived facts keep order of dependencies
+	std::ranges::stable_partition(order, [&] (term_id expression) {
+		auto it = proofs_.find(expression);
+		return it == proofs_.end() || it->second.rule == "axiom";
+	});
 
-			chain[next_index] = conclusions_[expression];
-			indices[expression] = next_index;
-			++next_index;
-		}
-	}
+	std::unordered_map<term_id, std::size_t> indices;
 
-	for (std::size_t i = 1; i < next_index; ++i)
+	for (std::size_t i = 0; i < order.size(); ++i)
 	{
-		const auto &node = chain[i];
+		const auto expression = order[i];
+		indices[expression] = i + 1;
 
-		ss << i << ". ";
+		ss << i + 1 << ". ";
 
-		if (node.rule == "axiom")
+		auto it = proofs_.find(expression);
+		if (it == proofs_.end() || it->second.rule == "axiom")
 		{
 			ss << "axiom";
 		}
 		else
 		{
+			const auto &node = it->second;
 			ss << node.rule << "(";
 
 			for (std::size_t k = 0; k < node.dependencies.size(); ++k)
@@ -405,7 +2092,7 @@ void Solver::build_thought_chain(Expression proof, Expression proved_target)
 			ss << ")";
 		}
 
-		ss << ": " << node.expression << '\n';
+		ss << ": " << store_.to_string(expression) << '\n';
 	}
 
 	// change variables if required
@@ -427,7 +2114,74 @@ void Solver::build_thought_chain(Expression proof, Expression proved_target)
 }
 
 
+void Solver::discharge_hypotheses(term_id proof_id, term_id proved_target_id)
+{
+	const auto target = std::ranges::find(targets_, proved_target_id);
+	if (target == targets_.begin() || target == targets_.end())
+	{
+		return;
+	}
+
+	// the first line of proof which is more general than target is its instance
+	Derivation derivation(store_);
+	std::size_t lines = 0;
+
+	for (const auto &expression : proof_order(proof_id))
+	{
+		const auto fact = expression == proof_id ? proved_target_id : expression;
+		auto it = proofs_.find(expression);
+
+		if (hypotheses_.contains(expression))
+		{
+			derivation.hypothesis(fact);
+		}
+		else if (it == proofs_.end() || it->second.rule == "axiom")
+		{
+			derivation.axiom_instance(fact);
+		}
+		else if (it->second.rule == "mp")
+		{
+			const auto &dependencies = it->second.dependencies;
+			derivation.mp(derivation.line(dependencies[0]), derivation.line(dependencies[1]), fact);
+		}
+		else
+		{
+			return;
+		}
+
+		++lines;
+	}
+
+	// Γ U {h1, ..., hk} ⊢ f => Γ ⊢ h1 > (... > (hk > f)), the last hypothesis goes first
+	for (auto it = std::make_reverse_iterator(target); it != targets_.rend(); ++it)
+	{
+		derivation = derivation.discharge(store_.left(*it));
+	}
+
+	ss << "discharged hypotheses: ⊢ " << store_.to_string(targets_.front()) << '\n';
+	ss << derivation.to_string(lines + 1);
+}
+
+
 std::string Solver::thought_chain() const
 {
 	return ss.str();
 }
+
+
+bool Solver::proved() const noexcept
+{
+	return proof_ != INVALID_TERM;
+}
+
+
+StopReason Solver::stop_reason() const noexcept
+{
+	return proved() ? StopReason::None : stats_.stop;
+}
+
+
+const SearchStats &Solver::stats() const noexcept
+{
+	return stats_;
+}
@@ -5,68 +5,463 @@
 #include <cstdint>
 #include <vector>
 #include <sstream>
-#include <fstream>
+#include <memory>
 #include <queue>
 #include <unordered_set>
 #include <unordered_map>
+#include <span>
+#include <functional>
+#include <limits>
 #include "../math/ast.hpp"
+#include "../math/arena.hpp"
+#include "../math/term_store.hpp"
+#include "../math/discrimination_tree.hpp"
+#include "../math/rule_schema.hpp"
+#include "../math/small_vector.hpp"
+#include "thread_pool.hpp"
+#include "dump_sink.hpp"
+#include "lemma_base.hpp"
+#include "lemma_store.hpp"
+#include "weights.hpp"
+#include "governor.hpp"
+#include "spill_queue.hpp"
+#include "derivation.hpp"
 
 
+/**
+ * @brief step of proof, dependencies are parents in proof DAG
+ */
 struct Node
 {
-	std::string expression;
+	term_id expression;
 	std::string rule;
-	std::vector<std::string> dependencies;
+	std::vector<term_id> dependencies;
+};
 
-	Node(std::string expression = "", std::string rule = "")
-		: expression(std::move(expression))
-		, rule(std::move(rule))
-		, dependencies({})
-	{
-		if (rule == "")
-		{
-			rule = "axiom";
-		}
-	}
+
+/**
+ * @brief how targets are searched for
+ * @note the first three strategies saturate knowledge base by generations,
+ * backward one additionally runs depth-first search from targets after every
+ * generation, bidirectional one grows frontier of subgoals and meets it with
+ * new facts. Given-clause one activates the lightest passive fact one by one.
+ */
+enum class Strategy
+{
+	Forward,
+	Backward,
+	Bidirectional,
+	GivenClause
+};
+
+
+// one step of iterative deepening on formula size
+struct DeepeningStep
+{
+	std::size_t bound;
+
+	// generations, or activations of given-clause search
+	std::size_t steps;
+	std::uint64_t time_ms;
+	std::size_t knowledge_base;
+};
+
+
+/**
+ * @brief sizes of search frontiers, one entry per generation
+ */
+struct SearchStats
+{
+	std::vector<std::size_t> forward_frontier;
+	std::vector<std::size_t> backward_frontier;
+	std::size_t knowledge_base = 0;
+
+	// subgoals closed by facts of forward search
+	std::size_t meetings = 0;
+
+	// facts selected by given-clause search
+	std::size_t activations = 0;
+
+	// lines of Kalmár proof, 0 if search found the proof
+	std::size_t kalmar_lines = 0;
+
+	// why search was stopped, derivations recorded and estimate of memory at the end
+	StopReason stop = StopReason::None;
+	std::uint64_t derivations = 0;
+	std::uint64_t memory = 0;
+
+	// facts which went to disk past memory cap and which came back
+	std::size_t spilled = 0;
+	std::size_t restored = 0;
+
+	std::vector<DeepeningStep> deepening;
+};
+
+
+/**
+ * @brief settings of search, defaults are those of Solver
+ * @note see setters of Solver for meaning of fields
+ */
+struct SolverOptions
+{
+	Strategy strategy = Strategy::Bidirectional;
+	std::size_t backward_depth = 3;
+	std::size_t forward_budget = std::numeric_limits<std::size_t>::max();
+	std::size_t backward_budget = 4096;
+	WeightConfig weights;
+
+	std::size_t initial_size = 0;
+	std::size_t size_step = 4;
+	std::size_t max_size = 32;
+
+	std::vector<Rule> rules;
+	std::size_t kalmar_atoms = 10;
+	std::uint64_t kalmar_after_ms = 10000;
+	Limits limits;
 };
 
 
 class Solver
 {
-	std::unordered_set<std::string> known_axioms_;
+	// expression produced by worker, not stored yet
+	struct Candidate
+	{
+		Expression expression;
+		std::uint64_t hash;
+
+		// position in sequential generation: (fact index << 32) | attempt
+		std::uint64_t order;
+
+		// index of rules_ or MODUS_PONENS and premises in order of rule
+		std::uint32_t rule;
+		SmallVector<term_id, 3> premises;
+	};
+
+	static constexpr const std::uint32_t MODUS_PONENS = static_cast<std::uint32_t>(-1);
+
+	// every expression of the solver is interned here
+	TermStore store_;
+
+	// normalized expressions keyed by canonical hash,
+	// ties are resolved exactly since equal expressions share id
+	std::unordered_set<term_id, CanonicalHash> known_axioms_;
 
 	// map hash value of expression to hash_values of dependent expressions
-	std::vector<Expression> axioms_;
-	std::vector<Expression> produced_;
+	std::vector<term_id> axioms_;
+	std::vector<term_id> produced_;
+
+	// indices of axioms_: whole facts, antecedents and consequents of implications
+	DiscriminationTree facts_;
+	DiscriminationTree antecedents_;
+	DiscriminationTree consequents_;
+
+	// facts of axioms_ which are instances of more general facts,
+	// they stay in indices but aren't combined anymore
+	std::vector<bool> retired_;
+
+	std::vector<term_id> targets_;
+
+	// normalized targets to be checked by workers without store
+	std::vector<Expression> target_expressions_;
+
+	// deadline, budgets and cancellation of search
+	Governor governor_;
+
+	// past memory cap new facts are spilled to disk until frontier runs out,
+	// new facts of generation are combined by chunks of adaptive size
+	std::uint64_t memory_cap_;
+	SpillQueue spill_;
+	std::size_t chunk_;
+
+	// workers of generation
+	ThreadPool pool_;
+
+	// scratch memory of workers, reset before every attempt
+	std::vector<std::unique_ptr<Arena>> arenas_;
 
-	std::vector<Expression> targets_;
-	std::uint64_t time_limit_;
+	// proof DAG keyed by fact, the first derivation of fact is kept
+	std::unordered_map<term_id, Node> proofs_;
 
 	// stream to store thought chain
 	std::stringstream ss;
-	std::ofstream dump_;
+
+	// optional debug dump of every derivation
+	std::unique_ptr<DumpSink> dump_;
+
+	// optional lemmas shared with other solvers
+	LemmaBase *lemma_base_;
+
+	// optional theorems known from previous runs
+	const LemmaStore *lemma_store_;
+
+	// facts which are valid only under assumptions of deduction theorem
+	std::unordered_set<term_id> hypotheses_;
+
+	// number of hypotheses which fact depends on, k-th target is proved only
+	// by facts of level up to k, facts without hypotheses aren't kept
+	std::unordered_map<term_id, std::size_t> levels_;
+
+	// fact which proves one of targets, INVALID_TERM if there is none
+	term_id proof_;
+
+	// max number of mp steps of backward chaining, 0 disables it
+	std::size_t backward_depth_;
+
+	Strategy strategy_;
+
+	// max number of facts of one generation and of subgoals of backward frontier
+	std::size_t forward_budget_;
+	std::size_t backward_budget_;
+	SearchStats stats_;
+
+	// weight of passive facts of given-clause search and pick-given ratio
+	weight_function weight_;
+	std::size_t age_ratio_;
+
+	// number of mp steps from axioms to derived facts
+	std::unordered_map<term_id, std::size_t> depths_;
+
+	// subgoal of bidirectional search raised from `parent` by `implication`
+	struct Subgoal
+	{
+		term_id goal;
+		std::uint32_t parent;
+		term_id implication;
+	};
+
+	std::vector<Subgoal> subgoals_;
+	std::unordered_set<term_id> subgoal_ids_;
+	DiscriminationTree open_subgoals_;
+
+	// facts of axioms_ before these indices were met with subgoals / raised them
+	std::size_t met_facts_;
+	std::size_t expanded_facts_;
+
+	// subgoals of backward chaining: facts which cover proved ones,
+	// depth of failed search over current knowledge base and current path
+	std::unordered_map<term_id, term_id> proved_goals_;
+	std::unordered_map<term_id, std::size_t> failed_goals_;
+	std::unordered_set<term_id> open_goals_;
+
+	// antecedent of implication goal which backward chaining took as hypothesis,
+	// steps over it stay in derivation until it's discharged
+	struct Context
+	{
+		term_id hypothesis;
+		Derivation derivation;
+		std::unordered_map<term_id, term_id> proved;
+		std::unordered_map<term_id, std::size_t> failed;
+	};
+	std::vector<Context> contexts_;
+
+	// deduction theorem is used by backward chaining, discharge needs the standard axioms
+	bool deduction_;
+
+	// size bounds of iterative deepening, initial bound 0 is derived from targets
+	std::size_t initial_size_;
+	std::size_t size_step_;
+	std::size_t max_size_;
+
+	// facts dropped by size bound or forward budget, retried with larger bound
+	std::vector<term_id> deferred_;
+
+	// derived rules of forward search applied in addition to mp
+	RuleSet rules_;
+
+	// targets with up to `kalmar_atoms_` atoms are proved by Kalmár construction
+	// if search doesn't find proof in `kalmar_after_ms_`
+	std::size_t kalmar_atoms_;
+	std::uint64_t kalmar_after_ms_;
+
+	// approximate bytes of store, proof DAG and knowledge base
+	std::uint64_t memory_usage() const;
+	bool over_cap() const;
+
+	// record up to `count` spilled facts which aren't known or subsumed yet
+	std::vector<term_id> restore(std::size_t count);
+
+	void record(term_id expression, std::string rule, std::vector<term_id> dependencies = {});
 
 	// Γ ⊢ A → B <=> Γ U {A} ⊢ B
-	bool deduction_theorem_decomposition(Expression expression);
+	bool deduction_theorem_decomposition(term_id expression);
+
+	// add fact to knowledge base and its indices unless it's subsumed and not kept
+	bool activate(term_id fact, bool keep);
 
 	// iteration function
 	void produce(std::size_t max_len);
 
-	// is any target if follows from expression?
-	bool is_target_proved_by(const Expression &expression) const;
+	// name of rule of candidate
+	const std::string &rule_name(std::uint32_t rule) const;
+
+	/**
+	 * @brief every tuple of active facts up to `index` which fills premises of
+	 * derived rule together with fact of `index`, until `apply` returns true
+	 * @note partners of premise are retrieved by its instance under unification
+	 * of premises filled before, so every tuple is passed once over all facts
+	 */
+	void combine_rules(
+		std::uint32_t index,
+		const std::function<bool(std::uint32_t, std::span<const term_id>)> &apply
+	) const;
+
+	FactInfo describe(term_id fact, std::uint64_t age, const std::vector<term_id> &target_subterms);
+
+	// best-first search which activates one passive fact per step
+	void given_clause(std::size_t max_len);
+
+	// search with fixed size bound until proof, saturation or timeout
+	bool search(std::size_t max_len);
+
+	// first size bound of iterative deepening
+	std::size_t initial_bound() const;
+
+	// next deepening step starts from active facts of knowledge base and deferred ones
+	void restart();
+
+	// is fact an instance of active fact of knowledge base?
+	bool is_subsumed(term_id expression);
+
+	// retire facts of knowledge base which are instances of expression
+	void retire_instances(term_id expression);
+
+	// fact of at most `depth` mp steps over knowledge base which `goal` is instance of
+	term_id prove_goal(term_id goal, std::size_t depth, std::size_t max_len, std::size_t &budget);
+
+	// fact of goal under open hypotheses, INVALID_TERM if there is none
+	term_id proved_goal(term_id goal) const;
+
+	// mp step of backward chaining, it's recorded unless hypothesis is open
+	void derive(term_id fact, term_id premise, term_id implication);
+
+	// Γ U {A} ⊢ B => Γ ⊢ A > B for ground goal A > B, fact which covers goal
+	term_id prove_by_deduction(term_id goal, std::size_t depth, std::size_t max_len, std::size_t &budget);
+
+	// goal-directed search from targets, fact which proves target is added to axioms_
+	bool backward_chaining(std::size_t max_len);
+
+	// add subgoal to backward frontier, true if it closes proof at once
+	bool raise_subgoal(term_id goal, std::uint32_t parent, term_id implication, std::size_t max_len);
+
+	// replay chain of mp steps from fact which covers subgoal up to target
+	bool close_subgoal(std::uint32_t subgoal, term_id fact);
+
+	// one round of bidirectional search over current knowledge base
+	bool bidirectional_step(std::size_t max_len);
+
+	// level of recorded fact and of fact derived from premises
+	std::size_t level(term_id fact) const;
+	std::size_t level(std::span<const term_id> premises) const;
+
+	// is any target if follows from expression, which isn't recorded yet if level is given?
+	bool is_target_proved_by(term_id expression);
+	bool is_target_proved_by(term_id expression, std::size_t level);
+	bool is_target_proved_by(const Expression &expression, std::size_t level) const;
 
 	// determine whether expression is good or not based on heuristic function
-	bool is_good_expression(const Expression &expression, std::size_t max_len) const;
+	bool is_good_expression(std::span<const Term> preorder, std::size_t max_len) const;
+
+	// facts required by proof in order of dependencies
+	std::vector<term_id> proof_order(term_id proof) const;
 
-	void build_thought_chain(Expression proof, Expression proved_target);
+	void build_thought_chain(term_id proof, term_id proved_target);
+
+	/**
+	 * @brief pure Hilbert proof of the first target where hypotheses of
+	 * deduction theorem are discharged from proof of later one
+	 * @note nothing is written if proof uses derived rules
+	 */
+	void discharge_hypotheses(term_id proof, term_id proved_target);
+
+	// seeds of lemma_table.hpp are the first facts of search and its other facts
+	// are retried with the next size bound, requires the standard axioms
+	void import_table(std::size_t max_len);
+
+	// exchange lemmas with lemma base
+	void import_lemmas(std::size_t max_len);
+	void publish_lemmas(term_id proof);
+
+	// record derivation of stored lemma, INVALID_TERM if it's not applicable
+	term_id expand_stored(std::size_t lemma);
+
+	// stored theorem which proves one of targets, INVALID_TERM if there is none
+	term_id find_stored_proof(term_id &target_proved);
 public:
 	Solver(std::vector<Expression> axioms,
 		Expression target,
-		std::uint64_t time_limit_ms = 60000
+		std::uint64_t time_limit_ms = 60000,
+		std::size_t threads = 1
 	);
 
+	// write every derivation to `path` in background
+	void dump_to(const std::string &path);
+
+	/**
+	 * @brief use lemmas of `base` as facts of the first generation and add
+	 * steps of found proof which don't depend on hypotheses to it
+	 * @note `base` must outlive solver
+	 */
+	void share_lemmas(LemmaBase &base);
+
+	/**
+	 * @brief targets which are known theorems of `store` are proved by their
+	 * stored derivations without search
+	 * @note `store` must outlive solver
+	 */
+	void use_store(const LemmaStore &store);
+
+	// max number of mp steps of backward chaining run after every generation,
+	// only Strategy::Backward runs it
+	void set_backward_depth(std::size_t depth);
+
+	void set_strategy(Strategy strategy);
+
+	// max number of facts of one generation and of open subgoals
+	void set_budgets(std::size_t forward, std::size_t backward);
+
+	// weight of given-clause search, every `age_ratio`-th given fact is the oldest one
+	void set_weight(weight_function weight, std::size_t age_ratio = 0);
+
+	/**
+	 * @brief size bounds of iterative deepening: bound grows by `step` up to
+	 * `max` every time search is saturated under it
+	 * @note `initial` 0 derives the first bound from targets
+	 */
+	void set_size_bounds(std::size_t initial, std::size_t step, std::size_t max);
+
+	/**
+	 * @brief derived rules which forward search applies in addition to mp,
+	 * their steps are named by rules in thought chain
+	 * @note backward chaining and subgoals use only mp, rules named `mp` are skipped
+	 */
+	void set_rules(const std::vector<Rule> &rules);
+
+	/**
+	 * @brief tautologies with up to `max_atoms` atoms which search doesn't prove
+	 * in `search_ms` are proved by Kalmár construction of kalmar.hpp
+	 * @note it requires the standard axioms, 0 atoms disables it
+	 */
+	void set_kalmar(std::size_t max_atoms, std::uint64_t search_ms);
+
+	/**
+	 * @brief time, derivations and memory of the next `solve`
+	 * @note it replaces time limit of constructor
+	 */
+	void set_limits(const Limits &limits);
+
+	// search stops soon after any copy of `token` is cancelled
+	void set_cancellation(CancellationToken token);
+
+	// every setting of `options` at once
+	void configure(const SolverOptions &options);
+
 	void solve();
 	std::string thought_chain() const;
+	bool proved() const noexcept;
+
+	// why search was stopped without proof, StopReason::None if it wasn't
+	StopReason stop_reason() const noexcept;
+	const SearchStats &stats() const noexcept;
 };
 
 #endif // SOLVER_HPP
@@ -0,0 +1,172 @@
+#include <cstring>
+#include <stdexcept>
+#include "spill_queue.hpp"
+
+
+namespace
+{
+
+// record: rule, number of premises, premises, then nodes of fact in preorder
+// as tag and value of leaf, size of fact is known from its file
+
+template <typename T>
+void put(std::string &buffer, T value)
+{
+	char bytes[sizeof(T)];
+	std::memcpy(bytes, &value, sizeof(T));
+	buffer.append(bytes, sizeof(T));
+}
+
+
+template <typename T>
+T get(std::FILE *stream)
+{
+	T value;
+	if (std::fread(&value, sizeof(T), 1, stream) != 1)
+	{
+		throw std::runtime_error("[-] error: can't read spilled fact");
+	}
+
+	return value;
+}
+
+}
+
+
+SpillQueue::SpillQueue()
+	: files_()
+	, size_(0)
+	, bytes_(0)
+	, waiting_()
+	, buffer_()
+{
+}
+
+
+std::FILE *SpillQueue::position(File &file, bool writing)
+{
+	// stream must be repositioned between reads and writes
+	if (file.writing != writing)
+	{
+		std::fseek(file.stream.get(), static_cast<long>(writing ? file.write : file.read), SEEK_SET);
+		file.writing = writing;
+	}
+
+	return file.stream.get();
+}
+
+
+bool SpillQueue::push(const Expression &expression, std::uint64_t hash, std::uint32_t rule, std::span<const term_id> premises)
+{
+	if (!waiting_.insert(hash).second)
+	{
+		return false;
+	}
+
+	const auto nodes = expression.size();
+	while (files_.size() <= nodes)
+	{
+		files_.push_back({{nullptr, std::fclose}, 0, 0, 0, false});
+	}
+
+	auto &file = files_[nodes];
+	if (!file.stream)
+	{
+		file.stream.reset(std::tmpfile());
+		if (!file.stream)
+		{
+			throw std::runtime_error("[-] error: can't create spill file");
+		}
+
+		// fresh stream is positioned at the start, which is the end of records
+		file.writing = true;
+	}
+
+	buffer_.clear();
+	put(buffer_, rule);
+	put(buffer_, static_cast<std::uint8_t>(premises.size()));
+	for (const auto &premise : premises)
+	{
+		put(buffer_, premise);
+	}
+
+	for (std::size_t i = 0; i < nodes; ++i)
+	{
+		const auto term = expression[i];
+		put(buffer_, pack_tag(term.type, term.op));
+		if (term.type != term_t::Function)
+		{
+			put(buffer_, term.value);
+		}
+	}
+
+	if (std::fwrite(buffer_.data(), 1, buffer_.size(), position(file, true)) != buffer_.size())
+	{
+		throw std::runtime_error("[-] error: can't write spilled fact");
+	}
+
+	file.write += buffer_.size();
+	++file.records;
+	++size_;
+	bytes_ += buffer_.size();
+	return true;
+}
+
+
+bool SpillQueue::pop(Record &record)
+{
+	auto file = files_.begin();
+	while (file != files_.end() && file->records == 0)
+	{
+		++file;
+	}
+
+	if (file == files_.end())
+	{
+		return false;
+	}
+
+	auto *stream = position(*file, false);
+	const auto start = std::ftell(stream);
+
+	record.rule = get<std::uint32_t>(stream);
+	record.premises.resize(get<std::uint8_t>(stream));
+	for (auto &premise : record.premises)
+	{
+		premise = get<term_id>(stream);
+	}
+
+	std::vector<Term> preorder(static_cast<std::size_t>(file - files_.begin()));
+	for (auto &term : preorder)
+	{
+		const auto tag = get<std::uint8_t>(stream);
+		term = Term(tag_type(tag), tag_op(tag), tag_type(tag) == term_t::Function ? 0 : get<value_t>(stream));
+	}
+	record.expression = Expression(preorder);
+	waiting_.erase(record.expression.hash());
+
+	const auto length = static_cast<std::uint64_t>(std::ftell(stream) - start);
+	file->read += length;
+	--file->records;
+	--size_;
+	bytes_ -= length;
+
+	// space of file is reused once everything is read
+	if (file->records == 0)
+	{
+		file->read = 0;
+		file->write = 0;
+		std::fseek(stream, 0, SEEK_SET);
+	}
+
+	return true;
+}
+
+
+std::size_t SpillQueue::memory() const noexcept
+{
+	// node of hash table holds next pointer and cached hash besides its value
+	return files_.capacity() * sizeof(File) + buffer_.capacity() +
+		waiting_.size() * (sizeof(std::uint64_t) + 2 * sizeof(void *)) +
+		waiting_.bucket_count() * sizeof(void *);
+}
@@ -0,0 +1,78 @@
+#ifndef SPILL_QUEUE_HPP
+#define SPILL_QUEUE_HPP
+
+#include <cstdio>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_set>
+#include "../math/ast.hpp"
+#include "../math/term_store.hpp"
+
+
+/**
+ * @brief facts of search which wait on disk together with steps deriving them
+ *
+ * @note records of every fact size are kept in their own anonymous temporary
+ * file, which is read back as FIFO, so only counters and hashes of waiting
+ * facts stay in memory. Fact which waits already isn't written again, facts
+ * of equal hashes are taken for the same one. Records are popped lightest
+ * first. Premises are ids of the store which facts were derived in, so they
+ * must be kept there.
+ */
+class SpillQueue
+{
+public:
+	struct Record
+	{
+		Expression expression;
+		std::uint32_t rule;
+		std::vector<term_id> premises;
+	};
+private:
+	struct File
+	{
+		std::unique_ptr<std::FILE, int (*)(std::FILE *)> stream;
+
+		// offsets of the next record and of the end of records
+		std::uint64_t read;
+		std::uint64_t write;
+		std::size_t records;
+		bool writing;
+	};
+
+	// indexed by number of nodes of fact
+	std::vector<File> files_;
+	std::size_t size_;
+	std::uint64_t bytes_;
+
+	// hashes of facts on disk
+	std::unordered_set<std::uint64_t> waiting_;
+
+	// serialized record
+	std::string buffer_;
+
+	// stream positioned at the end of records or at the next record
+	std::FILE *position(File &file, bool writing);
+public:
+	SpillQueue();
+
+	// false if the fact waits already, `hash` is Expression::hash of it
+	bool push(const Expression &expression, std::uint64_t hash, std::uint32_t rule, std::span<const term_id> premises);
+
+	// the lightest record, false if queue is empty
+	bool pop(Record &record);
+
+	inline std::size_t size() const noexcept { return size_; }
+	inline bool empty() const noexcept { return size_ == 0; }
+
+	// bytes of records on disk
+	inline std::uint64_t bytes() const noexcept { return bytes_; }
+
+	// approximate bytes of heap memory held by queue
+	std::size_t memory() const noexcept;
+};
+
+#endif // SPILL_QUEUE_HPP
@@ -0,0 +1,178 @@
+#include <algorithm>
+#include <utility>
+#include "thread_pool.hpp"
+
+
+ThreadPool::ThreadPool(std::size_t threads)
+	: threads_()
+	, queues_()
+	, job_(nullptr)
+	, batch_(0)
+	, running_(0)
+	, stop_(false)
+	, error_()
+	, failed_(false)
+{
+	threads = std::max<std::size_t>(threads, 1);
+
+	for (std::size_t i = 0; i < threads; ++i)
+	{
+		queues_.push_back(std::make_unique<Queue>());
+	}
+
+	for (std::size_t i = 1; i < threads; ++i)
+	{
+		threads_.emplace_back(&ThreadPool::loop, this, i);
+	}
+}
+
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard lock(mutex_);
+		stop_ = true;
+	}
+
+	start_.notify_all();
+	for (auto &thread : threads_)
+	{
+		thread.join();
+	}
+}
+
+
+bool ThreadPool::next_task(std::size_t worker, std::size_t &task)
+{
+	{
+		auto &own = *queues_[worker];
+		std::lock_guard lock(own.mutex);
+
+		if (!own.tasks.empty())
+		{
+			task = own.tasks.back();
+			own.tasks.pop_back();
+			return true;
+		}
+	}
+
+	for (std::size_t i = 1; i < queues_.size(); ++i)
+	{
+		auto &other = *queues_[(worker + i) % queues_.size()];
+		std::lock_guard lock(other.mutex);
+
+		if (!other.tasks.empty())
+		{
+			task = other.tasks.front();
+			other.tasks.pop_front();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+void ThreadPool::execute(std::size_t worker)
+{
+	// no task is added during the batch, so empty queues mean its end
+	std::size_t task = 0;
+	while (next_task(worker, task))
+	{
+		if (failed_.load(std::memory_order_relaxed))
+		{
+			continue;
+		}
+
+		try
+		{
+			(*job_)(task, worker);
+		}
+		catch (...)
+		{
+			std::lock_guard lock(mutex_);
+			if (!error_)
+			{
+				error_ = std::current_exception();
+			}
+			failed_.store(true, std::memory_order_relaxed);
+		}
+	}
+
+	std::lock_guard lock(mutex_);
+	if (--running_ == 0)
+	{
+		done_.notify_all();
+	}
+}
+
+
+void ThreadPool::loop(std::size_t worker)
+{
+	std::uint64_t seen = 0;
+
+	while (true)
+	{
+		{
+			std::unique_lock lock(mutex_);
+			start_.wait(lock, [&] { return stop_ || batch_ != seen; });
+
+			if (stop_)
+			{
+				return;
+			}
+
+			seen = batch_;
+		}
+
+		execute(worker);
+	}
+}
+
+
+void ThreadPool::run(std::size_t tasks, const job_t &job)
+{
+	if (tasks == 0)
+	{
+		return;
+	}
+
+	// contiguous chunks keep neighbouring tasks on the same worker
+	const auto workers = queues_.size();
+	const auto chunk = (tasks + workers - 1) / workers;
+
+	for (std::size_t i = 0; i < workers; ++i)
+	{
+		auto &queue = *queues_[i];
+		std::lock_guard lock(queue.mutex);
+
+		// own tasks are popped from back, so they are pushed in reverse
+		const auto begin = std::min(tasks, i * chunk);
+		const auto end = std::min(tasks, begin + chunk);
+		for (auto task = end; task > begin; --task)
+		{
+			queue.tasks.push_back(task - 1);
+		}
+	}
+
+	{
+		std::lock_guard lock(mutex_);
+		job_ = &job;
+		running_ = workers;
+		error_ = nullptr;
+		failed_.store(false, std::memory_order_relaxed);
+		++batch_;
+	}
+
+	start_.notify_all();
+	execute(0);
+
+	std::unique_lock lock(mutex_);
+	done_.wait(lock, [&] { return running_ == 0; });
+	job_ = nullptr;
+
+	if (error_)
+	{
+		std::rethrow_exception(std::exchange(error_, nullptr));
+	}
+}
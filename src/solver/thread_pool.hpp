@@ -0,0 +1,71 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <condition_variable>
+
+
+/**
+ * @brief pool of workers with work-stealing over per-worker task queues
+ *
+ * @note calling thread takes part in execution as worker 0,
+ * so pool of size 1 doesn't start any threads
+ */
+class ThreadPool
+{
+	using job_t = std::function<void(std::size_t task, std::size_t worker)>;
+
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque<std::size_t> tasks;
+	};
+
+	std::vector<std::thread> threads_;
+	std::vector<std::unique_ptr<Queue>> queues_;
+
+	// current batch
+	const job_t *job_;
+	std::uint64_t batch_;
+	std::size_t running_;
+	bool stop_;
+
+	// the first exception of batch, the rest of its tasks is skipped
+	std::exception_ptr error_;
+	std::atomic<bool> failed_;
+
+	std::mutex mutex_;
+	std::condition_variable start_;
+	std::condition_variable done_;
+
+	// pop own task from back or steal one from front of other queue
+	bool next_task(std::size_t worker, std::size_t &task);
+
+	void execute(std::size_t worker);
+	void loop(std::size_t worker);
+public:
+	explicit ThreadPool(std::size_t threads = 1);
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool &operator=(const ThreadPool &) = delete;
+	~ThreadPool();
+
+	inline std::size_t size() const noexcept { return queues_.size(); }
+
+	/**
+	 * @brief execute `job` for every task in [0, tasks) and wait for completion
+	 * @note tasks are distributed in contiguous chunks, idle workers steal.
+	 * If `job` throws, tasks not started yet are skipped and the first
+	 * exception is rethrown on the calling thread
+	 */
+	void run(std::size_t tasks, const job_t &job);
+};
+
+#endif // THREAD_POOL_HPP
@@ -0,0 +1,61 @@
+#include <sstream>
+#include <stdexcept>
+#include "weights.hpp"
+
+
+weight_function linear_weight(const WeightConfig &config)
+{
+	return [config] (const FactInfo &info)
+	{
+		return config.size * static_cast<double>(info.size) +
+			config.depth * static_cast<double>(info.depth) +
+			config.variables * static_cast<double>(info.variables) -
+			config.similarity * static_cast<double>(info.similarity);
+	};
+}
+
+
+WeightConfig parse_weights(const std::string &description)
+{
+	WeightConfig config;
+	std::stringstream ss(description);
+
+	for (std::string item; std::getline(ss, item, ',');)
+	{
+		const auto eq = item.find('=');
+		if (eq == std::string::npos)
+		{
+			throw std::invalid_argument("[-] error: weight must be name=value, got " + item);
+		}
+
+		const auto name = item.substr(0, eq);
+		const auto value = item.substr(eq + 1);
+
+		if (name == "size")
+		{
+			config.size = std::stod(value);
+		}
+		else if (name == "depth")
+		{
+			config.depth = std::stod(value);
+		}
+		else if (name == "vars")
+		{
+			config.variables = std::stod(value);
+		}
+		else if (name == "sim")
+		{
+			config.similarity = std::stod(value);
+		}
+		else if (name == "age")
+		{
+			config.age_ratio = std::stoul(value);
+		}
+		else
+		{
+			throw std::invalid_argument("[-] error: unknown weight " + name);
+		}
+	}
+
+	return config;
+}
@@ -0,0 +1,49 @@
+#ifndef WEIGHTS_HPP
+#define WEIGHTS_HPP
+
+#include <cstdint>
+#include <string>
+#include <functional>
+
+
+/**
+ * @brief features of passive fact of given-clause search
+ * @note similarity is number of subformulas which generalize subformula of target
+ */
+struct FactInfo
+{
+	std::size_t size;
+	std::size_t depth;
+	std::size_t variables;
+	std::size_t similarity;
+	std::uint64_t age;
+};
+
+
+// smaller weight is activated first
+using weight_function = std::function<double(const FactInfo &)>;
+
+
+/**
+ * @brief coefficients of linear weight and pick-given ratio
+ * @note every `age_ratio`-th given fact is the oldest one, 0 disables it
+ */
+struct WeightConfig
+{
+	double size = 1.0;
+	double depth = 0.0;
+	double variables = 0.0;
+	double similarity = 0.0;
+	std::size_t age_ratio = 5;
+};
+
+
+weight_function linear_weight(const WeightConfig &config);
+
+/**
+ * @brief parse comma separated `name=value` pairs
+ * @note names are size, depth, vars, sim and age
+ */
+WeightConfig parse_weights(const std::string &description);
+
+#endif // WEIGHTS_HPP
@@ -1,18 +1,350 @@
 #include <iostream>
+#include <fstream>
+#include <memory>
+#include <filesystem>
+#include <chrono>
+#include <csignal>
 #include <vector>
+#include <string>
+#include <algorithm>
+#include <stdexcept>
 #include "./math/ast.hpp"
 #include "./math/rules.hpp"
+#include "./math/rule_schema.hpp"
 #include "./solver/solver.hpp"
+#include "./solver/batch.hpp"
 #include "./math/helper.hpp"
 
 
-int main()
+// cancelled by the first SIGINT, so solver prints what it has, the second one kills
+CancellationToken interrupt;
+
+
+void on_interrupt(int)
 {
-	std::string expression_str;
-	std::cin >> expression_str;
-	Expression target(expression_str);
-	target.standardize();
-	target.make_permanent();
+	interrupt.cancel();
+	std::signal(SIGINT, SIG_DFL);
+}
+
+
+void print_stats(const SearchStats &stats)
+{
+	auto print = [] (const char *name, const std::vector<std::size_t> &sizes)
+	{
+		std::cerr << name << ':';
+		for (const auto &size : sizes)
+		{
+			std::cerr << ' ' << size;
+		}
+		std::cerr << '\n';
+	};
+
+	print("forward frontier", stats.forward_frontier);
+	print("backward frontier", stats.backward_frontier);
+	std::cerr << "knowledge base: " << stats.knowledge_base << '\n';
+	std::cerr << "meetings: " << stats.meetings << '\n';
+	std::cerr << "activations: " << stats.activations << '\n';
+	std::cerr << "kalmar lines: " << stats.kalmar_lines << '\n';
+	std::cerr << "stop reason: " << to_string(stats.stop) << '\n';
+	std::cerr << "derivations: " << stats.derivations << '\n';
+	std::cerr << "memory: " << stats.memory << " bytes\n";
+	std::cerr << "spilled: " << stats.spilled << ", restored: " << stats.restored << '\n';
+
+	for (const auto &step : stats.deepening)
+	{
+		std::cerr << "size bound " << step.bound << ": " << step.steps << " steps, "
+			<< step.time_ms << " ms, knowledge base " << step.knowledge_base << '\n';
+	}
+}
+
+
+// previous store is kept, so it is rewritten only when something was learned
+void save_store(const std::string &path, const LemmaStore *store, const LemmaBase &learned)
+{
+	LemmaBase merged;
+	if (store != nullptr)
+	{
+		merged.merge(store->lemmas());
+	}
+
+	const auto known = merged.size();
+	merged.merge(learned.snapshot());
+
+	if (store == nullptr || merged.size() != known)
+	{
+		LemmaStore::save(path, merged.snapshot());
+	}
+}
+
+
+int run_batch(
+	const std::string &path,
+	const std::vector<Expression> &axioms,
+	LemmaBase &lemmas,
+	const LemmaStore *store,
+	std::size_t threads,
+	const SolverOptions &options
+)
+{
+	std::ifstream input(path);
+	if (!input)
+	{
+		std::cerr << "[-] error: can't open " << path << '\n';
+		return 1;
+	}
+
+	std::vector<std::string> targets;
+	for (std::string line; std::getline(input, line);)
+	{
+		if (line.find_first_not_of(" \t\r") != std::string::npos)
+		{
+			targets.push_back(line);
+		}
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	const auto results = prove_batch(targets, axioms, lemmas, store, threads, options, interrupt);
+	const auto total = std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::steady_clock::now() - start
+	).count();
+
+	std::size_t proved = 0;
+	for (const auto &result : results)
+	{
+		std::cout << "input: " << result.input << '\n';
+		std::cout << "normalized input: " << result.normalized << "\n\n";
+		std::cout << result.thought_chain << '\n';
+		std::cout << "time: " << result.time_ms << " ms\n\n";
+
+		proved += result.proved ? 1 : 0;
+	}
+
+	std::cout << "proved " << proved << "/" << results.size()
+		<< " in " << total << " ms (" << (total == 0 ? 0 : proved * 3600000 / total)
+		<< " proofs/hour)\n";
+	return 0;
+}
+
+
+// options of command line
+void print_usage(const char *program)
+{
+	std::cerr << "usage: " << program << " [--threads N] [--dump FILE] [--batch FILE] [--store FILE]"
+		<< " [--backward DEPTH (with --strategy backward)]"
+		<< " [--strategy forward|backward|bidirectional|given-clause]"
+		<< " [--weights size=1,depth=0,vars=0,sim=0,age=5]"
+		<< " [--forward-budget N] [--backward-budget N]"
+		<< " [--initial-size N] [--size-step N] [--max-size N]"
+		<< " [--rules mp,mt,ds,ss,cr,hs,scd,sdd,ccd,cdd] [--rule NAME SCHEMA]"
+		<< " [--kalmar ATOMS] [--kalmar-after MS]"
+		<< " [--time-limit MS] [--max-derivations N] [--max-memory MB] [--memory-cap MB] [--stats]\n";
+}
+
+
+// non-negative integer of option, std::invalid_argument if value is anything else
+std::uint64_t parse_number(const char *value)
+{
+	const std::string_view text = value;
+	if (text.empty() || text.find_first_not_of("0123456789") != std::string_view::npos)
+	{
+		throw std::invalid_argument("[-] error: expected non-negative integer, got " + std::string(text));
+	}
+
+	return std::stoull(std::string(text));
+}
+
+
+int main(int argc, char *argv[])
+{
+	std::size_t threads = 1;
+	std::string dump;
+	std::string batch;
+	std::string store_path;
+	bool stats = false;
+	SolverOptions options;
+
+	std::string_view arg;
+	try
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			arg = argv[i];
+
+			if (arg == "--threads" && i + 1 < argc)
+			{
+				threads = std::max<std::size_t>(1, parse_number(argv[++i]));
+				continue;
+			}
+
+			if (arg == "--dump" && i + 1 < argc)
+			{
+				dump = argv[++i];
+				continue;
+			}
+
+			if (arg == "--batch" && i + 1 < argc)
+			{
+				batch = argv[++i];
+				continue;
+			}
+
+			if (arg == "--backward" && i + 1 < argc)
+			{
+				options.backward_depth = parse_number(argv[++i]);
+				continue;
+			}
+
+			if (arg == "--strategy" && i + 1 < argc)
+			{
+				const std::string_view name = argv[++i];
+				if (name == "forward" || name == "backward" ||
+					name == "bidirectional" || name == "given-clause")
+				{
+					options.strategy = name == "forward" ? Strategy::Forward :
+						name == "backward" ? Strategy::Backward :
+						name == "bidirectional" ? Strategy::Bidirectional :
+						Strategy::GivenClause;
+					continue;
+				}
+			}
+
+			if (arg == "--forward-budget" && i + 1 < argc)
+			{
+				options.forward_budget = parse_number(argv[++i]);
+				continue;
+			}
+
+			if (arg == "--backward-budget" && i + 1 < argc)
+			{
+				options.backward_budget = parse_number(argv[++i]);
+				continue;
+			}
+
+			if (arg == "--initial-size" && i + 1 < argc)
+			{
+				options.initial_size = parse_number(argv[++i]);
+				continue;
+			}
+
+			if (arg == "--size-step" && i + 1 < argc)
+			{
+				options.size_step = parse_number(argv[++i]);
+				if (options.size_step == 0)
+				{
+					throw std::invalid_argument("[-] error: --size-step must be positive");
+				}
+				continue;
+			}
+
+			if (arg == "--max-size" && i + 1 < argc)
+			{
+				options.max_size = parse_number(argv[++i]);
+				continue;
+			}
+
+			if (arg == "--rules" && i + 1 < argc)
+			{
+				std::string_view names = argv[++i];
+				while (!names.empty())
+				{
+					const auto comma = std::min(names.find(','), names.size());
+					const auto *rule = find_rule(names.substr(0, comma));
+					if (rule == nullptr)
+					{
+						throw std::invalid_argument("[-] error: unknown rule " + std::string(names.substr(0, comma)));
+					}
+
+					options.rules.push_back(*rule);
+					names.remove_prefix(std::min(comma + 1, names.size()));
+				}
+				continue;
+			}
+
+			if (arg == "--rule" && i + 2 < argc)
+			{
+				options.rules.push_back(compile_rule(argv[i + 1], argv[i + 2]));
+				i += 2;
+				continue;
+			}
+
+			if (arg == "--kalmar" && i + 1 < argc)
+			{
+				options.kalmar_atoms = parse_number(argv[++i]);
+				continue;
+			}
+
+			if (arg == "--kalmar-after" && i + 1 < argc)
+			{
+				options.kalmar_after_ms = parse_number(argv[++i]);
+				continue;
+			}
+
+			if (arg == "--time-limit" && i + 1 < argc)
+			{
+				options.limits.time_ms = parse_number(argv[++i]);
+				continue;
+			}
+
+			if (arg == "--max-derivations" && i + 1 < argc)
+			{
+				options.limits.derivations = parse_number(argv[++i]);
+				continue;
+			}
+
+			if (arg == "--max-memory" && i + 1 < argc)
+			{
+				options.limits.memory_bytes = parse_number(argv[++i]) << 20;
+				continue;
+			}
+
+			if (arg == "--memory-cap" && i + 1 < argc)
+			{
+				options.limits.memory_cap = parse_number(argv[++i]) << 20;
+				continue;
+			}
+
+			if (arg == "--weights" && i + 1 < argc)
+			{
+				options.weights = parse_weights(argv[++i]);
+				continue;
+			}
+
+			if (arg == "--stats")
+			{
+				stats = true;
+				continue;
+			}
+
+			if (arg == "--store" && i + 1 < argc)
+			{
+				store_path = argv[++i];
+				continue;
+			}
+
+			throw std::invalid_argument("[-] error: unknown option or missing value " + std::string(arg));
+		}
+
+		if (options.max_size == 0 || options.initial_size > options.max_size)
+		{
+			throw std::invalid_argument("[-] error: --initial-size must not exceed positive --max-size");
+		}
+	}
+	catch (const std::exception &e)
+	{
+		// conversions of the standard library throw bare names of functions
+		const std::string_view message = e.what();
+		if (message.starts_with("[-] error:"))
+		{
+			std::cerr << message << '\n';
+		}
+		else
+		{
+			std::cerr << "[-] error: invalid value of " << arg << '\n';
+		}
+
+		print_usage(argv[0]);
+		return 1;
+	}
 
 	std::vector<Expression> axioms = {
 		Expression("a>(b>a)"),
@@ -20,13 +352,76 @@ int main()
 		Expression("(!a>!b)>((!a>b)>a)")
 	};
 
+	// theorems of previous runs, new ones are added after the run
+	std::unique_ptr<LemmaStore> store;
+	if (!store_path.empty() && std::filesystem::exists(store_path))
+	{
+		try
+		{
+			store = std::make_unique<LemmaStore>(store_path);
+		}
+		catch (const std::exception &e)
+		{
+			std::cerr << e.what() << '\n';
+			return 1;
+		}
+	}
+
+	LemmaBase learned;
+	std::signal(SIGINT, on_interrupt);
+
+	// targets are read from file one per line and solved concurrently
+	if (!batch.empty())
+	{
+		const auto code = run_batch(batch, axioms, learned, store.get(), threads, options);
+		if (code == 0 && !store_path.empty())
+		{
+			save_store(store_path, store.get(), learned);
+		}
+
+		return code;
+	}
+
+	std::string expression_str;
+	std::cin >> expression_str;
+	Expression target(expression_str);
+	target.standardize();
+	target.make_permanent();
+
 	std::cout << "input: " << expression_str << '\n';
 	std::cout << "normalized input: " << target << "\n\n";
 
-	Solver solve(axioms, target);
+	Solver solve(axioms, target, options.limits.time_ms, threads);
+	solve.configure(options);
+	solve.set_cancellation(interrupt);
+	if (!dump.empty())
+	{
+		solve.dump_to(dump);
+	}
+
+	if (!store_path.empty())
+	{
+		solve.share_lemmas(learned);
+		if (store)
+		{
+			solve.use_store(*store);
+		}
+	}
+
 	solve.solve();
 
 	std::cout << solve.thought_chain() << '\n';
+
+	if (stats)
+	{
+		print_stats(solve.stats());
+	}
+
+	if (!store_path.empty())
+	{
+		save_store(store_path, store.get(), learned);
+	}
+
 	return 0;
 }
 
@@ -0,0 +1,235 @@
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <functional>
+#include "../math/ast.hpp"
+#include "../math/term_store.hpp"
+
+
+/**
+ * @brief parse -> standardize -> normalize -> print on very large formulas,
+ * then walks of TermStore over deep tautology
+ *
+ * @note every stage must be linear, so time per node should stay
+ * the same when size grows 10 times; deep chains would overflow
+ * the stack if any of the stages was recursive
+ */
+
+constexpr const char operations[] = {'|', '>', '*', '|', '+', '='};
+
+
+char variable(std::size_t i)
+{
+	return static_cast<char>('a' + i % 26);
+}
+
+
+std::string negated(std::size_t i)
+{
+	return i % 3 == 0 ? "!" : (i % 7 == 0 ? "!!" : "");
+}
+
+
+// ((((a|b)>c)*d)...)
+std::string left_chain(std::size_t leaves)
+{
+	std::string result(leaves - 1, '(');
+	result += variable(0);
+
+	for (std::size_t i = 1; i < leaves; ++i)
+	{
+		result += operations[i % std::size(operations)];
+		result += negated(i);
+		result += variable(i);
+		result += ')';
+	}
+
+	return result;
+}
+
+
+// a|(!b>(c*(...)))
+std::string right_chain(std::size_t leaves)
+{
+	std::string result;
+
+	for (std::size_t i = 0; i + 1 < leaves; ++i)
+	{
+		result += negated(i);
+		result += variable(i);
+		result += operations[i % std::size(operations)];
+		result += '(';
+	}
+
+	result += variable(leaves - 1);
+	result += std::string(leaves - 1, ')');
+	return result;
+}
+
+
+// ((a|b)>(c*d))|...
+std::string balanced(std::size_t leaves)
+{
+	std::vector<std::string> level;
+	for (std::size_t i = 0; i < leaves; ++i)
+	{
+		level.push_back(negated(i) + variable(i));
+	}
+
+	for (std::size_t depth = 0; level.size() > 1; ++depth)
+	{
+		std::vector<std::string> next;
+		for (std::size_t i = 0; i + 1 < level.size(); i += 2)
+		{
+			next.push_back(
+				negated(i + depth) + "(" + level[i] +
+				operations[(i + depth) % std::size(operations)] +
+				level[i + 1] + ")"
+			);
+		}
+
+		if (level.size() % 2 == 1)
+		{
+			next.push_back(level.back());
+		}
+
+		level = std::move(next);
+	}
+
+	return level[0];
+}
+
+
+// ((..(a>a)>a)..)>a
+std::string deep_tautology(std::size_t implications, char atom)
+{
+	std::string result(implications - 1, '(');
+	result += atom;
+
+	for (std::size_t i = 0; i < implications; ++i)
+	{
+		result += '>';
+		result += atom;
+		if (i + 1 < implications)
+		{
+			result += ')';
+		}
+	}
+
+	return result;
+}
+
+
+double measure(const std::function<void()> &stage)
+{
+	const auto start = std::chrono::steady_clock::now();
+	stage();
+	const auto end = std::chrono::steady_clock::now();
+
+	return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+
+int main()
+{
+	const std::vector<std::pair<std::string, std::function<std::string(std::size_t)>>> shapes = {
+		{"left chain", left_chain},
+		{"right chain", right_chain},
+		{"balanced", balanced}
+	};
+
+	std::cout << std::left << std::setw(12) << "shape"
+		<< std::right << std::setw(10) << "nodes"
+		<< std::setw(12) << "parse ms"
+		<< std::setw(12) << "std ms"
+		<< std::setw(12) << "norm ms"
+		<< std::setw(12) << "print ms"
+		<< std::setw(12) << "ns/node" << '\n';
+
+	for (const auto &[name, generate] : shapes)
+	{
+		for (const std::size_t leaves : {50'000ul, 500'000ul})
+		{
+			const auto input = generate(leaves);
+
+			Expression expression;
+			std::string output;
+
+			const auto parse = measure([&] { expression = Expression(input); });
+			const auto standardize = measure([&] { expression.standardize(); });
+			const auto normalize = measure([&] { expression.normalize(); });
+			const auto print = measure([&] { output = expression.to_string(); });
+
+			const auto total = parse + standardize + normalize + print;
+			std::cout << std::left << std::setw(12) << name
+				<< std::right << std::setw(10) << expression.size()
+				<< std::fixed << std::setprecision(2)
+				<< std::setw(12) << parse
+				<< std::setw(12) << standardize
+				<< std::setw(12) << normalize
+				<< std::setw(12) << print
+				<< std::setw(12) << total * 1e6 / expression.size() << '\n';
+		}
+	}
+
+	std::cout << '\n' << std::left << std::setw(12) << "store"
+		<< std::right << std::setw(10) << "nodes"
+		<< std::setw(12) << "intern ms"
+		<< std::setw(12) << "print ms"
+		<< std::setw(12) << "neg ms"
+		<< std::setw(12) << "norm ms"
+		<< std::setw(12) << "equals ms"
+		<< std::setw(12) << "find ms"
+		<< std::setw(12) << "ns/node" << '\n';
+
+	for (const std::size_t implications : {30'000ul, 50'000ul})
+	{
+		// copy over other variable is normalized back, copy over constants equals it
+		const Expression tautology(deep_tautology(implications, 'a'));
+		const Expression renamed(deep_tautology(implications, 'b'));
+		Expression permanent = tautology;
+		permanent.make_permanent();
+
+		TermStore store;
+		term_id id = INVALID_TERM;
+		term_id renamed_id = INVALID_TERM;
+		term_id permanent_id = INVALID_TERM;
+		std::string output;
+		bool same = false;
+		bool found = false;
+
+		const auto intern = measure([&] {
+			id = store.intern(tautology);
+			renamed_id = store.intern(renamed);
+			permanent_id = store.intern(permanent);
+		});
+		const auto print = measure([&] { output = store.to_string(id); });
+		const auto negate = measure([&] { store.negation(id); });
+		const auto normalize = measure([&] { same = store.normalize(renamed_id) == id; });
+		const auto equals = measure([&] { same = same && store.equals(id, permanent_id); });
+		const auto contains = measure([&] { found = store.contains(id, tautology[tautology.size() - 1].value); });
+
+		if (!same || !found || output.size() != 4 * implications - 1)
+		{
+			std::cerr << "[-] error: walks of store disagree on deep tautology\n";
+			return 1;
+		}
+
+		const auto total = intern + print + negate + normalize + equals + contains;
+		std::cout << std::left << std::setw(12) << "tautology"
+			<< std::right << std::setw(10) << tautology.size()
+			<< std::fixed << std::setprecision(2)
+			<< std::setw(12) << intern
+			<< std::setw(12) << print
+			<< std::setw(12) << negate
+			<< std::setw(12) << normalize
+			<< std::setw(12) << equals
+			<< std::setw(12) << contains
+			<< std::setw(12) << total * 1e6 / tautology.size() << '\n';
+	}
+
+	return 0;
+}
@@ -0,0 +1,97 @@
+#include <cassert>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../math/ast.hpp"
+#include "../solver/solver.hpp"
+
+
+/**
+ * @brief regressions of parser and solver: inputs which are normalized
+ * and proved like by `pc-solver`
+ */
+
+std::vector<Expression> axioms()
+{
+	return {
+		Expression("a>(b>a)"),
+		Expression("(a>(b>c))>((a>b)>(a>c))"),
+		Expression("(!a>!b)>((!a>b)>a)")
+	};
+}
+
+
+Expression normalized(const std::string &input)
+{
+	Expression target(input);
+	target.standardize();
+	target.make_permanent();
+	return target;
+}
+
+
+// input is normalized to `expected` and proved
+void test_proved(const std::string &input, const std::string &expected)
+{
+	const auto target = normalized(input);
+	assert(target.to_string() == expected);
+
+	Solver solver(axioms(), target, 5000);
+	solver.solve();
+	assert(solver.proved());
+}
+
+
+// negation of `|` negates both operands: !(a|b) = !a*!b
+void test_negated_disjunction()
+{
+	test_proved("!(a|b)>!a", "(!a*!b)>!a");
+	test_proved("!(!a|b)>a", "(a*!b)>a");
+	test_proved("!((a>a)|b)>!a", "((a*!a)*!b)>!a");
+	test_proved("(!a*!b)>!(a|b)", "(!a*!b)>(!a*!b)");
+	test_proved("!!(a|b)>(!a>b)", "(!a>b)>(!a>b)");
+
+	std::cout << "Test negated disjunction passed." << std::endl;
+}
+
+
+// the last line after discharge of hypotheses is target itself
+void test_discharged_goal()
+{
+	const auto target = normalized("a>(b>a)");
+
+	Solver solver(axioms(), target, 5000);
+	solver.set_strategy(Strategy::GivenClause);
+	solver.solve();
+	assert(solver.proved());
+
+	const auto chain = solver.thought_chain();
+	const auto discharged = chain.find("discharged hypotheses:");
+	assert(discharged != std::string::npos);
+
+	std::istringstream lines(chain.substr(discharged));
+	std::string line;
+	std::string last;
+	while (std::getline(lines, line))
+	{
+		if (!line.empty())
+		{
+			last = line;
+		}
+	}
+
+	const auto fact = last.find(": ");
+	assert(fact != std::string::npos);
+	assert(last.substr(fact + 2) == target.to_string());
+
+	std::cout << "Test discharged goal passed." << std::endl;
+}
+
+
+int main()
+{
+	test_negated_disjunction();
+	test_discharged_goal();
+	return 0;
+}